@@ -0,0 +1,401 @@
+#include "AudioAnalyzer.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+float const MIN_BPM = 60;
+float const MAX_BPM = 200;
+float const PREFERRED_BPM = 120;
+float const TEMPO_WINDOW_SECONDS = 6;
+float const ONSET_MIN_GAP_SECONDS = 0.1;
+float const ONSET_THRESHOLD_DEVIATIONS = 1.5;
+float const ONSET_FLUX_FLOOR = 0.1;
+int const FLUX_HISTORY_SIZE = 43;
+size_t const WRITE_CHUNK = 256;
+
+struct WavData {
+    int sampleRate = 0;
+    int channels = 0;
+    std::vector<float> samples;
+};
+
+template <typename T>
+bool readValue(std::istream& in, T& value) {
+    return (bool)in.read(reinterpret_cast<char*>(&value), sizeof(T));
+}
+
+// PCM 16/24/32 bit or 32 bit float, little endian, interleaved.
+bool readWav(std::string const& path, WavData& wav) {
+    std::ifstream in(path, std::ios::binary);
+    char riff[4], wave[4];
+    uint32_t riffSize;
+    if (!in.read(riff, 4) || !readValue(in, riffSize) || !in.read(wave, 4)) {
+        return false;
+    }
+    if (std::string(riff, 4) != "RIFF" || std::string(wave, 4) != "WAVE") {
+        return false;
+    }
+
+    uint16_t format = 0, bitsPerSample = 0;
+    char id[4];
+    uint32_t size;
+    while (in.read(id, 4) && readValue(in, size)) {
+        std::string const chunk(id, 4);
+        if (chunk == "fmt ") {
+            uint16_t channels, blockAlign;
+            uint32_t sampleRate, byteRate;
+            readValue(in, format);
+            readValue(in, channels);
+            readValue(in, sampleRate);
+            readValue(in, byteRate);
+            readValue(in, blockAlign);
+            readValue(in, bitsPerSample);
+            if (format == 0xFFFE && size >= 26) {
+                // WAVE_FORMAT_EXTENSIBLE keeps the real format in the sub-format GUID.
+                uint16_t extensionSize, validBits;
+                uint32_t channelMask;
+                readValue(in, extensionSize);
+                readValue(in, validBits);
+                readValue(in, channelMask);
+                readValue(in, format);
+                in.seekg(size - 26, std::ios::cur);
+            } else {
+                in.seekg(size - 16, std::ios::cur);
+            }
+            wav.channels = channels;
+            wav.sampleRate = sampleRate;
+        } else if (chunk == "data") {
+            bool const pcm = format == 1 && (bitsPerSample == 16 || bitsPerSample == 24);
+            bool const floats = format == 3 && bitsPerSample == 32;
+            if (wav.channels == 0 || (!pcm && !floats)) {
+                return false;
+            }
+            std::vector<char> bytes(size);
+            in.read(bytes.data(), size);
+            size_t const bytesPerSample = bitsPerSample / 8;
+            size_t const count = in.gcount() / bytesPerSample;
+            wav.samples.resize(count);
+            for (size_t i = 0; i < count; i++) {
+                unsigned char const* sample = reinterpret_cast<unsigned char const*>(&bytes[i * bytesPerSample]);
+                if (floats) {
+                    std::memcpy(&wav.samples[i], sample, 4);
+                } else if (bitsPerSample == 16) {
+                    wav.samples[i] = int16_t(sample[0] | sample[1] << 8) / 32768.0f;
+                } else {
+                    int32_t const value = (sample[0] << 8 | sample[1] << 16 | sample[2] << 24) >> 8;
+                    wav.samples[i] = value / 8388608.0f;
+                }
+            }
+            return true;
+        } else {
+            in.seekg(size + (size & 1), std::ios::cur);
+        }
+    }
+    return false;
+}
+
+}
+
+AudioAnalyzer::AudioAnalyzer() : samples(1 << 15), running(false), droppedSamples(0), publishedVolume(0), onsetCount(0), tempo(0), tempoConfidence(0) {
+    for (auto& band : publishedBands) {
+        band = 0;
+    }
+}
+
+AudioAnalyzer::~AudioAnalyzer() {
+    stop();
+}
+
+void AudioAnalyzer::start(int sampleRate, int hopSize) {
+    stop();
+    this->sampleRate = sampleRate;
+    this->hopSize = std::min(hopSize, FFT_SIZE);
+
+    window.resize(FFT_SIZE);
+    for (int i = 0; i < FFT_SIZE; i++) {
+        window[i] = 0.5 - 0.5 * cos(TWO_PI * i / FFT_SIZE);
+    }
+    frame.assign(FFT_SIZE, 0);
+    spectrum.resize(FFT_SIZE);
+    twiddles.resize(FFT_SIZE / 2);
+    for (int k = 0; k < FFT_SIZE / 2; k++) {
+        twiddles[k] = std::polar(1.0f, float(-TWO_PI * k / FFT_SIZE));
+    }
+    bitReversed.resize(FFT_SIZE);
+    int bits = 0;
+    while ((1 << bits) < FFT_SIZE) {
+        bits++;
+    }
+    for (int i = 0; i < FFT_SIZE; i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        }
+        bitReversed[i] = reversed;
+    }
+    magnitudes.assign(FFT_SIZE / 2 + 1, 0);
+    previousMagnitudes.assign(FFT_SIZE / 2 + 1, 0);
+
+    // Log-spaced bands from 40 Hz up to 16 kHz or Nyquist.
+    float const lowest = 40;
+    float const highest = std::min(16000.0f, sampleRate / 2.0f);
+    bandEdges.resize(BAND_COUNT + 1);
+    for (int band = 0; band <= BAND_COUNT; band++) {
+        float const frequency = lowest * pow(highest / lowest, float(band) / BAND_COUNT);
+        int const bin = ofClamp(round(frequency * FFT_SIZE / sampleRate), 1, FFT_SIZE / 2);
+        bandEdges[band] = band > 0 ? std::max(bin, bandEdges[band - 1] + 1) : bin;
+    }
+
+    float const hopRate = float(sampleRate) / this->hopSize;
+    fluxHistory.assign(FLUX_HISTORY_SIZE, 0);
+    fluxHistoryNext = 0;
+    onsetEnvelope.assign(ceil(TEMPO_WINDOW_SECONDS * hopRate), 0);
+    onsetEnvelopeNext = 0;
+    hopCount = 0;
+    lastOnsetHop = 0;
+    smoothedVolume = 0;
+
+    running = true;
+    thread = std::thread(&AudioAnalyzer::threadedFunction, this);
+}
+
+void AudioAnalyzer::stop() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void AudioAnalyzer::write(float const* input, int bufferSize, int nChannels) {
+    float mono[WRITE_CHUNK];
+    for (int offset = 0; offset < bufferSize; offset += WRITE_CHUNK) {
+        int const frames = std::min<int>(WRITE_CHUNK, bufferSize - offset);
+        for (int i = 0; i < frames; i++) {
+            float sum = 0;
+            for (int channel = 0; channel < nChannels; channel++) {
+                sum += input[(offset + i) * nChannels + channel];
+            }
+            mono[i] = sum / nChannels;
+        }
+        droppedSamples += frames - samples.push(mono, frames);
+    }
+}
+
+float AudioAnalyzer::getSmoothedVolume() const {
+    return publishedVolume.load(std::memory_order_relaxed);
+}
+
+float AudioAnalyzer::getBandEnergy(int band) const {
+    return publishedBands[band].load(std::memory_order_relaxed);
+}
+
+uint32_t AudioAnalyzer::getOnsetCount() const {
+    return onsetCount.load(std::memory_order_relaxed);
+}
+
+float AudioAnalyzer::getTempo() const {
+    return tempo.load(std::memory_order_relaxed);
+}
+
+float AudioAnalyzer::getTempoConfidence() const {
+    return tempoConfidence.load(std::memory_order_relaxed);
+}
+
+uint64_t AudioAnalyzer::getDroppedSamples() const {
+    return droppedSamples.load(std::memory_order_relaxed);
+}
+
+void AudioAnalyzer::threadedFunction() {
+    std::vector<float> hop(hopSize);
+    size_t filled = 0;
+    while (running) {
+        size_t const popped = samples.pop(hop.data() + filled, hopSize - filled);
+        filled += popped;
+        if (filled == hop.size()) {
+            analyzeHop(hop.data());
+            filled = 0;
+        } else if (popped == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+void AudioAnalyzer::analyzeHop(float const* hop) {
+    // Same volume follower the audio callback used to run.
+    float volume = 0;
+    for (int i = 0; i < hopSize; i++) {
+        float const sample = hop[i] * 0.5;
+        volume += sample * sample;
+    }
+    volume = sqrt(volume / hopSize);
+    smoothedVolume = smoothedVolume * 0.93 + 0.07 * volume;
+    publishedVolume.store(smoothedVolume, std::memory_order_relaxed);
+
+    std::copy(frame.begin() + hopSize, frame.end(), frame.begin());
+    std::copy(hop, hop + hopSize, frame.end() - hopSize);
+    computeSpectrum();
+
+    for (int band = 0; band < BAND_COUNT; band++) {
+        float energy = 0;
+        for (int bin = bandEdges[band]; bin < bandEdges[band + 1]; bin++) {
+            energy += magnitudes[bin] * magnitudes[bin];
+        }
+        publishedBands[band].store(energy / (bandEdges[band + 1] - bandEdges[band]), std::memory_order_relaxed);
+    }
+
+    // Spectral flux over log-compressed magnitudes.
+    float flux = 0;
+    for (size_t bin = 0; bin < magnitudes.size(); bin++) {
+        float const compressed = log1p(10 * magnitudes[bin]);
+        flux += std::max(0.0f, compressed - previousMagnitudes[bin]);
+        previousMagnitudes[bin] = compressed;
+    }
+    detectOnset(flux);
+
+    hopCount++;
+    int const tempoInterval = std::max(1, sampleRate / hopSize / 2);
+    if (hopCount >= onsetEnvelope.size() && hopCount % tempoInterval == 0) {
+        estimateTempo();
+    }
+}
+
+void AudioAnalyzer::computeSpectrum() {
+    for (int i = 0; i < FFT_SIZE; i++) {
+        spectrum[bitReversed[i]] = frame[i] * window[i];
+    }
+    for (int size = 2; size <= FFT_SIZE; size *= 2) {
+        int const half = size / 2;
+        int const step = FFT_SIZE / size;
+        for (int start = 0; start < FFT_SIZE; start += size) {
+            for (int k = 0; k < half; k++) {
+                auto const t = twiddles[k * step] * spectrum[start + k + half];
+                auto const u = spectrum[start + k];
+                spectrum[start + k] = u + t;
+                spectrum[start + k + half] = u - t;
+            }
+        }
+    }
+    for (size_t bin = 0; bin < magnitudes.size(); bin++) {
+        magnitudes[bin] = std::abs(spectrum[bin]) * 2 / FFT_SIZE;
+    }
+}
+
+void AudioAnalyzer::detectOnset(float flux) {
+    float mean = 0;
+    for (auto f : fluxHistory) {
+        mean += f;
+    }
+    mean /= fluxHistory.size();
+    float variance = 0;
+    for (auto f : fluxHistory) {
+        variance += (f - mean) * (f - mean);
+    }
+    float const threshold = mean + ONSET_THRESHOLD_DEVIATIONS * sqrt(variance / fluxHistory.size()) + ONSET_FLUX_FLOOR;
+
+    uint64_t const minGap = ONSET_MIN_GAP_SECONDS * sampleRate / hopSize;
+    if (flux > threshold && hopCount - lastOnsetHop >= minGap) {
+        lastOnsetHop = hopCount;
+        onsetCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    fluxHistory[fluxHistoryNext] = flux;
+    fluxHistoryNext = (fluxHistoryNext + 1) % fluxHistory.size();
+    onsetEnvelope[onsetEnvelopeNext] = std::max(0.0f, flux - mean);
+    onsetEnvelopeNext = (onsetEnvelopeNext + 1) % onsetEnvelope.size();
+}
+
+void AudioAnalyzer::estimateTempo() {
+    // Autocorrelate the onset envelope and pick the strongest beat period,
+    // leaning towards PREFERRED_BPM to avoid octave errors.
+    size_t const length = onsetEnvelope.size();
+    auto envelope = [&](size_t i) { return onsetEnvelope[(onsetEnvelopeNext + i) % length]; };
+    float const hopRate = float(sampleRate) / hopSize;
+    int const minLag = floor(60 * hopRate / MAX_BPM);
+    int const maxLag = ceil(60 * hopRate / MIN_BPM);
+    if (maxLag + 1 >= (int)length) {
+        return;
+    }
+
+    float energy = 0;
+    for (size_t i = 0; i < length; i++) {
+        energy += envelope(i) * envelope(i);
+    }
+    if (energy <= 0) {
+        return;
+    }
+
+    std::vector<float> correlation(maxLag + 2, 0);
+    for (int lag = minLag - 1; lag <= maxLag + 1; lag++) {
+        for (size_t i = lag; i < length; i++) {
+            correlation[lag] += envelope(i) * envelope(i - lag);
+        }
+    }
+
+    int bestLag = 0;
+    float bestScore = 0;
+    for (int lag = minLag; lag <= maxLag; lag++) {
+        float const octaves = log2(60 * hopRate / lag / PREFERRED_BPM);
+        float const score = correlation[lag] * exp(-0.5 * octaves * octaves);
+        if (score > bestScore) {
+            bestScore = score;
+            bestLag = lag;
+        }
+    }
+    if (bestLag == 0) {
+        return;
+    }
+
+    float const left = correlation[bestLag - 1];
+    float const center = correlation[bestLag];
+    float const right = correlation[bestLag + 1];
+    float const curvature = left - 2 * center + right;
+    float const offset = curvature < 0 ? 0.5 * (left - right) / curvature : 0;
+    float const estimate = 60 * hopRate / (bestLag + offset);
+
+    float const previous = tempo.load(std::memory_order_relaxed);
+    float const smoothed = previous > 0 && std::abs(estimate - previous) < 0.1 * previous ? previous * 0.7 + estimate * 0.3 : estimate;
+    tempo.store(smoothed, std::memory_order_relaxed);
+    tempoConfidence.store(center / energy, std::memory_order_relaxed);
+}
+
+int AudioAnalyzer::analyzeFile(std::string const& path) {
+    WavData wav;
+    if (!readWav(path, wav)) {
+        std::cout << "Could not read " << path << " as PCM or float WAV" << std::endl;
+        return 1;
+    }
+
+    int const hopSize = 256;
+    size_t const frames = wav.samples.size() / wav.channels;
+    AudioAnalyzer analyzer;
+    analyzer.start(wav.sampleRate, hopSize);
+
+    auto const startTime = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < frames; offset += hopSize) {
+        int const count = std::min<size_t>(hopSize, frames - offset);
+        while (analyzer.samples.capacity() - analyzer.samples.size() < (size_t)count) {
+            std::this_thread::yield();
+        }
+        analyzer.write(&wav.samples[offset * wav.channels], count, wav.channels);
+    }
+    while (analyzer.samples.size() >= (size_t)hopSize) {
+        std::this_thread::yield();
+    }
+    analyzer.stop();
+    double const elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    double const duration = double(frames) / wav.sampleRate;
+
+    std::cout << path << ": " << duration << " s, " << wav.sampleRate << " Hz, " << wav.channels << " channel(s)" << std::endl;
+    std::cout << "  analyzed at " << duration / std::max(elapsed, 1e-9) << "x real time" << std::endl;
+    std::cout << "  onsets: " << analyzer.getOnsetCount() << std::endl;
+    std::cout << "  tempo: " << analyzer.getTempo() << " BPM (confidence " << analyzer.getTempoConfidence() << ")" << std::endl;
+    std::cout << "  final smoothed volume: " << analyzer.getSmoothedVolume() << std::endl;
+    std::cout << "  final band energies:";
+    for (int band = 0; band < BAND_COUNT; band++) {
+        std::cout << " " << analyzer.getBandEnergy(band);
+    }
+    std::cout << std::endl;
+    return 0;
+}
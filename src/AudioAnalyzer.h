@@ -0,0 +1,76 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <complex>
+#include <thread>
+
+// Audio analysis off the audio thread. The sound card callback only copies
+// samples into a lock-free ring; a worker thread slices them into hops, runs
+// an FFT, and publishes volume, band energies, onsets and a tempo estimate
+// through atomics that update() can read at any time.
+class AudioAnalyzer {
+public:
+    static int const FFT_SIZE = 1024;
+    static int const BAND_COUNT = 8;
+
+    AudioAnalyzer();
+    ~AudioAnalyzer();
+
+    void start(int sampleRate, int hopSize);
+    void stop();
+
+    // Audio thread. Mixes interleaved channels down to mono; never blocks.
+    void write(float const* input, int bufferSize, int nChannels);
+
+    float getSmoothedVolume() const;
+    float getBandEnergy(int band) const;
+    uint32_t getOnsetCount() const;
+    float getTempo() const;
+    float getTempoConfidence() const;
+    uint64_t getDroppedSamples() const;
+
+    // Runs a WAV file through the same ring and worker as live input, as fast
+    // as the worker can go, and prints what it found. Returns an exit code.
+    static int analyzeFile(std::string const& path);
+
+private:
+    void threadedFunction();
+    void analyzeHop(float const* hop);
+    void computeSpectrum();
+    void detectOnset(float flux);
+    void estimateTempo();
+
+    SpscRing<float> samples;
+    std::thread thread;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> droppedSamples;
+
+    int sampleRate = 44100;
+    int hopSize = 256;
+    uint64_t hopCount = 0;
+
+    // Worker-only analysis state
+    std::vector<float> window;
+    std::vector<float> frame;
+    std::vector<std::complex<float>> spectrum;
+    std::vector<std::complex<float>> twiddles;
+    std::vector<int> bitReversed;
+    std::vector<float> magnitudes;
+    std::vector<float> previousMagnitudes;
+    std::vector<int> bandEdges;
+    std::vector<float> fluxHistory;
+    size_t fluxHistoryNext = 0;
+    std::vector<float> onsetEnvelope;
+    size_t onsetEnvelopeNext = 0;
+    uint64_t lastOnsetHop = 0;
+    float smoothedVolume = 0;
+
+    // Published to other threads
+    std::atomic<float> publishedVolume;
+    std::atomic<float> publishedBands[BAND_COUNT];
+    std::atomic<uint32_t> onsetCount;
+    std::atomic<float> tempo;
+    std::atomic<float> tempoConfidence;
+};
@@ -0,0 +1,199 @@
+#include "BatchNoise.h"
+#include "ofMain.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BATCH_NOISE_X86
+#include <immintrin.h>
+#endif
+
+// ofNoise(float) is Stefan Gustavson's 1D simplex noise. Its gradient for
+// lattice point i is a pure function of perm[i & 0xff], so the lookup and
+// the sign/magnitude decode fold into one table.
+static float const GRADIENTS[256] = {
+    8, 1, -2, -4, -3, -8, 4, -6, -2, -8, 1, 6, 3, -2, 8, 2,
+    -5, 5, 8, -7, 6, -7, -1, 4, 6, 1, 6, -3, 8, -7, 7, 5,
+    8, -1, -3, -4, 1, -3, 6, -7, -7, -5, -4, -4, 6, 4, -4, 1,
+    -2, 2, 2, -1, -6, 6, -1, 8, -7, 5, -6, -1, -4, -1, 5, -8,
+    -3, 6, 8, 7, -4, 1, -4, 7, -6, 3, -7, 8, 4, -8, 6, -3,
+    -5, 4, 6, 7, -5, -2, -5, -2, 8, -7, 6, -1, 5, 7, -8, 7,
+    2, -2, -8, 2, 2, -1, 1, -2, 2, -5, 5, -4, 1, -2, 3, -2,
+    -1, 5, 8, 3, 5, -5, -8, 7, 5, 5, -6, 7, -6, -3, 4, 1,
+    5, -2, 3, -3, -5, -4, 6, -3, 7, 4, 7, -7, -8, 3, 6, 5,
+    -8, -7, -4, 4, -8, 1, -3, 2, 7, -6, -5, -3, -8, 8, -3, 6,
+    8, -1, -1, 3, -5, -3, 4, 7, -6, -2, 6, -4, 8, -4, -5, -2,
+    2, 7, 8, -6, 4, 3, -5, -7, -8, 2, 1, -1, 3, -2, 1, -1,
+    -3, 7, 2, 5, -4, 3, 3, 2, -7, 3, 1, -5, -8, 4, 3, 2,
+    2, 4, 2, -4, -2, -7, -8, -4, 2, 1, 7, -8, 6, 8, -3, -6,
+    -1, 5, -5, 1, 4, -2, 3, -6, -8, 5, 7, -7, -3, -5, -6, -6,
+    -7, 3, 4, -6, -1, -1, 4, -6, 1, 4, -7, 3, 8, -6, -5, 5,
+};
+
+BatchNoise::Kernel BatchNoise::kernel = BatchNoise::OF_NOISE;
+
+static inline float noiseScalar(float x) {
+    // Same floor, operation order and constants as _slang_library_noise1.
+    int const i0 = x > 0 ? (int)x : (int)x - 1;
+    float const x0 = x - i0;
+    float const x1 = x0 - 1.0f;
+    float t0 = 1.0f - x0 * x0;
+    t0 *= t0;
+    float t1 = 1.0f - x1 * x1;
+    t1 *= t1;
+    float const n0 = t0 * t0 * (GRADIENTS[i0 & 0xff] * x0);
+    float const n1 = t1 * t1 * (GRADIENTS[(i0 + 1) & 0xff] * x1);
+    return 0.25f * (n0 + n1) * 0.5f + 0.5f;
+}
+
+static void noiseScalar(float const* in, float* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = noiseScalar(in[i]);
+    }
+}
+
+#ifdef BATCH_NOISE_X86
+__attribute__((target("sse2")))
+static void noiseSse2(float const* in, float* out, size_t count) {
+    __m128 const zero = _mm_setzero_ps();
+    __m128 const one = _mm_set1_ps(1.0f);
+    __m128 const quarter = _mm_set1_ps(0.25f);
+    __m128 const half = _mm_set1_ps(0.5f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 const x = _mm_loadu_ps(in + i);
+        // Truncate, then step down by one wherever x <= 0 (the mask is -1).
+        __m128i const notPositive = _mm_castps_si128(_mm_cmple_ps(x, zero));
+        __m128i const i0 = _mm_add_epi32(_mm_cvttps_epi32(x), notPositive);
+        __m128 const x0 = _mm_sub_ps(x, _mm_cvtepi32_ps(i0));
+        __m128 const x1 = _mm_sub_ps(x0, one);
+        __m128 t0 = _mm_sub_ps(one, _mm_mul_ps(x0, x0));
+        t0 = _mm_mul_ps(t0, t0);
+        __m128 t1 = _mm_sub_ps(one, _mm_mul_ps(x1, x1));
+        t1 = _mm_mul_ps(t1, t1);
+
+        alignas(16) int32_t lattice[4];
+        _mm_store_si128((__m128i*)lattice, i0);
+        __m128 const g0 = _mm_setr_ps(GRADIENTS[lattice[0] & 0xff], GRADIENTS[lattice[1] & 0xff], GRADIENTS[lattice[2] & 0xff], GRADIENTS[lattice[3] & 0xff]);
+        __m128 const g1 = _mm_setr_ps(GRADIENTS[(lattice[0] + 1) & 0xff], GRADIENTS[(lattice[1] + 1) & 0xff], GRADIENTS[(lattice[2] + 1) & 0xff], GRADIENTS[(lattice[3] + 1) & 0xff]);
+
+        __m128 const n0 = _mm_mul_ps(_mm_mul_ps(t0, t0), _mm_mul_ps(g0, x0));
+        __m128 const n1 = _mm_mul_ps(_mm_mul_ps(t1, t1), _mm_mul_ps(g1, x1));
+        __m128 const n = _mm_mul_ps(_mm_mul_ps(quarter, _mm_add_ps(n0, n1)), half);
+        _mm_storeu_ps(out + i, _mm_add_ps(n, half));
+    }
+    noiseScalar(in + i, out + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void noiseAvx2(float const* in, float* out, size_t count) {
+    __m256 const zero = _mm256_setzero_ps();
+    __m256 const one = _mm256_set1_ps(1.0f);
+    __m256 const quarter = _mm256_set1_ps(0.25f);
+    __m256 const half = _mm256_set1_ps(0.5f);
+    __m256i const byteMask = _mm256_set1_epi32(0xff);
+    __m256i const oneInt = _mm256_set1_epi32(1);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 const x = _mm256_loadu_ps(in + i);
+        __m256i const notPositive = _mm256_castps_si256(_mm256_cmp_ps(x, zero, _CMP_LE_OQ));
+        __m256i const i0 = _mm256_add_epi32(_mm256_cvttps_epi32(x), notPositive);
+        __m256 const x0 = _mm256_sub_ps(x, _mm256_cvtepi32_ps(i0));
+        __m256 const x1 = _mm256_sub_ps(x0, one);
+        __m256 t0 = _mm256_sub_ps(one, _mm256_mul_ps(x0, x0));
+        t0 = _mm256_mul_ps(t0, t0);
+        __m256 t1 = _mm256_sub_ps(one, _mm256_mul_ps(x1, x1));
+        t1 = _mm256_mul_ps(t1, t1);
+
+        __m256 const g0 = _mm256_i32gather_ps(GRADIENTS, _mm256_and_si256(i0, byteMask), 4);
+        __m256 const g1 = _mm256_i32gather_ps(GRADIENTS, _mm256_and_si256(_mm256_add_epi32(i0, oneInt), byteMask), 4);
+
+        __m256 const n0 = _mm256_mul_ps(_mm256_mul_ps(t0, t0), _mm256_mul_ps(g0, x0));
+        __m256 const n1 = _mm256_mul_ps(_mm256_mul_ps(t1, t1), _mm256_mul_ps(g1, x1));
+        __m256 const n = _mm256_mul_ps(_mm256_mul_ps(quarter, _mm256_add_ps(n0, n1)), half);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(n, half));
+    }
+    noiseSse2(in + i, out + i, count - i);
+}
+#endif
+
+void BatchNoise::setup() {
+    std::vector<Kernel> candidates;
+#ifdef BATCH_NOISE_X86
+    if (__builtin_cpu_supports("avx2")) {
+        candidates.push_back(AVX2);
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        candidates.push_back(SSE2);
+    }
+#endif
+    candidates.push_back(SCALAR);
+
+    kernel = OF_NOISE;
+    for (auto candidate : candidates) {
+        // Wide sweep for lattice coverage, narrow sweep for fine detail.
+        float const error = std::max(maxError(candidate, -1e4, 1e4, 100003), maxError(candidate, -2, 2, 10007));
+        if (error <= TOLERANCE) {
+            kernel = candidate;
+            break;
+        }
+        ofLogWarning("BatchNoise") << getKernelName(candidate) << " kernel is off from ofNoise by " << error << ", skipping it";
+    }
+    ofLogNotice("BatchNoise") << "Using " << getKernelName(kernel) << " noise kernel";
+}
+
+BatchNoise::Kernel BatchNoise::getKernel() {
+    return kernel;
+}
+
+std::string BatchNoise::getKernelName(Kernel kernel) {
+    switch (kernel) {
+        case OF_NOISE:
+            return "ofNoise";
+        case SCALAR:
+            return "scalar";
+        case SSE2:
+            return "SSE2";
+        case AVX2:
+            return "AVX2";
+    }
+    return "unknown";
+}
+
+void BatchNoise::noise(float const* in, float* out, size_t count) {
+    noise(kernel, in, out, count);
+}
+
+void BatchNoise::noise(Kernel kernel, float const* in, float* out, size_t count) {
+    switch (kernel) {
+#ifdef BATCH_NOISE_X86
+        case AVX2:
+            noiseAvx2(in, out, count);
+            return;
+        case SSE2:
+            noiseSse2(in, out, count);
+            return;
+#endif
+        case SCALAR:
+            noiseScalar(in, out, count);
+            return;
+        default:
+            for (size_t i = 0; i < count; i++) {
+                out[i] = ofNoise(in[i]);
+            }
+            return;
+    }
+}
+
+float BatchNoise::maxError(Kernel kernel, float from, float to, size_t count) {
+    std::vector<float> in(count);
+    std::vector<float> out(count);
+    for (size_t i = 0; i < count; i++) {
+        in[i] = from + (to - from) * i / count;
+    }
+    noise(kernel, in.data(), out.data(), count);
+
+    float error = 0;
+    for (size_t i = 0; i < count; i++) {
+        error = std::max(error, std::abs(out[i] - ofNoise(in[i])));
+    }
+    return error;
+}
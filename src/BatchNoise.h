@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// ofNoise(float) over whole arrays at once. Uses AVX2 or SSE2 when the CPU
+// has them and falls back to a scalar loop otherwise. setup() checks the
+// chosen kernel against ofNoise and drops back to calling ofNoise directly if
+// it ever disagrees by more than TOLERANCE.
+class BatchNoise {
+public:
+    enum Kernel {
+        OF_NOISE,
+        SCALAR,
+        SSE2,
+        AVX2
+    };
+
+    static constexpr float TOLERANCE = 1e-6f;
+
+    static void setup();
+    static Kernel getKernel();
+    static std::string getKernelName(Kernel kernel);
+
+    // out[i] = ofNoise(in[i])
+    static void noise(float const* in, float* out, size_t count);
+    static void noise(Kernel kernel, float const* in, float* out, size_t count);
+
+    // Largest |noise(x) - ofNoise(x)| over count evenly spaced x in [from, to).
+    static float maxError(Kernel kernel, float from, float to, size_t count);
+
+private:
+    static Kernel kernel;
+};
@@ -0,0 +1,721 @@
+#include "Benchmark.h"
+#include "BatchNoise.h"
+#include "SpatialHash.h"
+#include "StreamReceiver.h"
+#include "StreamSender.h"
+#include "TracerPool.h"
+#include "ofxBenG.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <unistd.h>
+
+namespace {
+
+int const TRACER_COUNT = 127;
+int const MAX_POINTS = 1000;
+int const WARM_UP_FRAMES = 120;
+int const MEASURED_FRAMES = 60;
+
+int const SUITE_TRACER_COUNTS[] = {1, 10, 100, 1000, 10000};
+int const SUITE_MAX_POINTS[] = {10, 100, 1000};
+int const SUITE_MULTIPLIER_COUNTS[] = {0, 5, 25, 100, 255};
+// Beyond these a sweep point needs gigabytes of history or stroke mesh.
+int const MAX_SUITE_POINTS = 1000000;
+int const MAX_SUITE_STROKE_SEGMENTS = 2000000;
+int const SAMPLES = 7;
+double const MIN_SAMPLE_SECONDS = 0.02;
+int const MAX_SAMPLE_RUNS = 1 << 20;
+int const PROPERTY_COUNT = 64;
+
+typedef std::chrono::steady_clock Clock;
+
+struct Row {
+    std::string benchmark;
+    int tracers;
+    int maxPoints;
+    int multiplierCount;
+    int threads;
+};
+
+double secondsSince(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Median nanoseconds per run(), over samples long enough for the clock.
+template <typename Run>
+double measure(Run const& run) {
+    int runs = 1;
+    for (;;) {
+        auto const start = Clock::now();
+        for (int i = 0; i < runs; i++) {
+            run();
+        }
+        if (secondsSince(start) >= MIN_SAMPLE_SECONDS || runs >= MAX_SAMPLE_RUNS) {
+            break;
+        }
+        runs *= 2;
+    }
+
+    std::vector<double> samples;
+    for (int sample = 0; sample < SAMPLES; sample++) {
+        auto const start = Clock::now();
+        for (int i = 0; i < runs; i++) {
+            run();
+        }
+        samples.push_back(secondsSince(start) * 1e9 / runs);
+    }
+    std::nth_element(samples.begin(), samples.begin() + SAMPLES / 2, samples.end());
+    return samples[SAMPLES / 2];
+}
+
+// As measure(), but setup() runs untimed before every run().
+template <typename Setup, typename Run>
+double measure(Setup const& setup, Run const& run) {
+    std::vector<double> samples;
+    for (int sample = 0; sample < SAMPLES; sample++) {
+        double seconds = 0;
+        int runs = 0;
+        while (seconds < MIN_SAMPLE_SECONDS && runs < MAX_SAMPLE_RUNS) {
+            setup();
+            auto const start = Clock::now();
+            run();
+            seconds += secondsSince(start);
+            runs++;
+        }
+        samples.push_back(seconds * 1e9 / runs);
+    }
+    std::nth_element(samples.begin(), samples.begin() + SAMPLES / 2, samples.end());
+    return samples[SAMPLES / 2];
+}
+
+void writeRow(std::ostream& out, Row const& row, double nanos) {
+    out << row.benchmark << "," << row.tracers << "," << row.maxPoints << "," << row.multiplierCount << "," << row.threads
+        << "," << nanos << "," << (row.tracers > 0 ? nanos / row.tracers : 0) << std::endl;
+}
+
+std::string getKey(std::string const& line) {
+    // Everything before nanosPerRun identifies the row.
+    size_t end = 0;
+    for (int field = 0; field < 5; field++) {
+        end = line.find(',', field > 0 ? end + 1 : 0);
+        if (end == std::string::npos) {
+            return line;
+        }
+    }
+    return line.substr(0, end);
+}
+
+double getNanos(std::string const& line) {
+    return atof(line.c_str() + getKey(line).size() + 1);
+}
+
+std::map<std::string, double> readResults(std::string const& path) {
+    std::map<std::string, double> results;
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    while (std::getline(file, line)) {
+        if (!line.empty()) {
+            results[getKey(line)] = getNanos(line);
+        }
+    }
+    return results;
+}
+
+TracerPool::Frame makeFrame(float time, int maxPoints) {
+    TracerPool::Frame frame;
+    frame.time = time;
+    frame.rangeX = ofVec2f(-350, 350);
+    frame.rangeY = ofVec2f(-350, 350);
+    frame.rangeZ = ofVec2f(-350, 350);
+    frame.boxSize = ofVec3f(150);
+    frame.maxPoints = maxPoints;
+    frame.farMaxPoints = maxPoints;
+    frame.viewNormal = ofVec3f(0, 0, 1);
+    frame.curveResolution = 20;
+    frame.repulsion = 0;
+    frame.flocking = 0;
+    frame.interactionRadius = 30;
+    frame.sparkDistance = 0;
+    return frame;
+}
+
+TracerPool::Frame makeInteractingFrame(float time, int maxPoints) {
+    auto frame = makeFrame(time, maxPoints);
+    frame.repulsion = 0.5;
+    frame.flocking = 0.5;
+    frame.sparkDistance = 3;
+    return frame;
+}
+
+TracerPool::Style makeStyle(int multiplierCount) {
+    TracerPool::Style style;
+    style.strokeColor = ofColor::white;
+    style.strokeWidth = 3;
+    style.multiplierCount = multiplierCount;
+    style.maxShift = 3;
+    style.entropy = 0.5;
+    style.viewNormal = ofVec3f(0, 0, 1);
+    return style;
+}
+
+void spawn(TracerPool& pool, int count) {
+    for (int i = 0; i < count; i++) {
+        pool.spawn(ofVec3f(0, 0, 0), ofVec3f(ofRandom(700), ofRandom(700), ofRandom(700)), ofVec3f(0.001));
+    }
+}
+
+// Whether two pools hold the same points and build the same strokes, to the bit.
+bool isIdentical(TracerPool& a, TracerPool& b, std::string& difference) {
+    if (a.size() != b.size()) {
+        difference = "tracer counts differ";
+        return false;
+    }
+    for (size_t tracer = 0; tracer < a.size(); tracer++) {
+        auto const pointsA = a.getPoints(tracer);
+        auto const pointsB = b.getPoints(tracer);
+        if (pointsA.size() != pointsB.size()) {
+            difference = "tracer " + ofToString(tracer) + " has " + ofToString(pointsA.size()) + " points, not " + ofToString(pointsB.size());
+            return false;
+        }
+        for (size_t i = 0; i < pointsA.size(); i++) {
+            if (memcmp(pointsA[i].getPtr(), pointsB[i].getPtr(), sizeof(float[3])) != 0) {
+                difference = "tracer " + ofToString(tracer) + " differs at point " + ofToString(i);
+                return false;
+            }
+        }
+    }
+
+    std::vector<StrokeMesh::Instanced> strokesA;
+    std::vector<StrokeMesh::Instanced> strokesB;
+    auto const style = makeStyle(0);
+    a.buildStrokes(style, strokesA);
+    b.buildStrokes(style, strokesB);
+    for (size_t tracer = 0; tracer < strokesA.size(); tracer++) {
+        auto const& verticesA = strokesA[tracer].mesh.getVertices();
+        auto const& verticesB = strokesB[tracer].mesh.getVertices();
+        if (verticesA.size() != verticesB.size()
+            || (!verticesA.empty() && memcmp(&verticesA[0], &verticesB[0], verticesA.size() * sizeof(verticesA[0])) != 0)) {
+            difference = "stroke " + ofToString(tracer) + " differs";
+            return false;
+        }
+    }
+    return true;
+}
+
+// The fused update against the same chain run pass by pass, while
+// farMaxPoints drops halfway through.
+bool checkFusedUpdate(ofVec3f const& boxSize) {
+    int const tracers = 300;
+    int const frames = 300;
+    int const maxPoints = 100;
+    JobSystem jobs(0);
+    TracerPool fused(maxPoints);
+    TracerPool passByPass(maxPoints);
+    ofSeedRandom(1);
+    spawn(fused, tracers);
+    ofSeedRandom(1);
+    spawn(passByPass, tracers);
+    // Running a pass twice changes nothing, but no longer matches a compiled chain.
+    auto pipeline = TracerPool::getDefaultPipeline();
+    pipeline.insert(pipeline.begin(), TracerPool::SET_HEADS_TO_ZERO);
+    passByPass.setPipeline(pipeline);
+
+    std::string difference;
+    if (!fused.isPipelineFused() || passByPass.isPipelineFused()) {
+        difference = "pipelines did not specialize as expected";
+    } else {
+        float time = 0;
+        for (int i = 0; i < frames; i++) {
+            auto frame = makeFrame(time += 1000.0 / 60, maxPoints);
+            frame.boxSize = boxSize;
+            frame.viewNormal = ofVec3f(0.3, 0.5, 0.8).getNormalized();
+            frame.farMaxPoints = i < frames / 2 ? maxPoints : maxPoints / 3;
+            fused.update(frame, jobs);
+            passByPass.update(frame, jobs);
+        }
+        isIdentical(fused, passByPass, difference);
+    }
+
+    std::cout << "fusedUpdate, boxSize " << boxSize.x << ": " << (difference.empty() ? "ok" : "FAILED, " + difference) << std::endl;
+    return difference.empty();
+}
+
+
+// Every neighbor the hash visits against a brute-force search, with no
+// point visited twice.
+bool checkSpatialHash() {
+    int const pointCount = 5000;
+    float const radius = 30;
+    ofSeedRandom(1);
+    std::vector<ofVec3f> points;
+    for (int i = 0; i < pointCount; i++) {
+        points.push_back(ofVec3f(ofRandom(-350, 350), ofRandom(-350, 350), ofRandom(-350, 350)));
+    }
+    SpatialHash grid;
+    grid.build(points.data(), points.size(), radius);
+
+    int mismatches = 0;
+    std::vector<uint32_t> visited;
+    std::vector<uint32_t> expected;
+    for (size_t i = 0; i < points.size(); i++) {
+        visited.clear();
+        grid.forEachNear(points[i], [&](uint32_t j) {
+            if (points[i].squareDistance(points[j]) < radius * radius) {
+                visited.push_back(j);
+            }
+        });
+        expected.clear();
+        for (size_t j = 0; j < points.size(); j++) {
+            if (points[i].squareDistance(points[j]) < radius * radius) {
+                expected.push_back(j);
+            }
+        }
+        std::sort(visited.begin(), visited.end());
+        if (visited != expected) {
+            mismatches++;
+        }
+    }
+
+    std::cout << "spatialHash, " << pointCount << " points: ";
+    if (mismatches == 0) {
+        std::cout << "ok" << std::endl;
+    } else {
+        std::cout << "FAILED, " << mismatches << " points found the wrong neighbors" << std::endl;
+    }
+    return mismatches == 0;
+}
+
+// Once tracers stop interacting they ease back onto the paths of a pool
+// that never interacted, without a jump, and end up exactly on them.
+bool checkSettling() {
+    int const tracers = 300;
+    int const maxPoints = 100;
+    int const interactingFrames = 60;
+    int const settlingFrames = 400;
+    JobSystem jobs(0);
+    TracerPool settling(maxPoints);
+    TracerPool reference(maxPoints);
+    ofSeedRandom(1);
+    spawn(settling, tracers);
+    ofSeedRandom(1);
+    spawn(reference, tracers);
+
+    auto const getLargestOffset = [&]() {
+        float largest = 0;
+        for (int i = 0; i < tracers; i++) {
+            largest = std::max(largest, settling.getHeads()[i].distance(reference.getHeads()[i]));
+        }
+        return largest;
+    };
+
+    float time = 0;
+    for (int i = 0; i < interactingFrames; i++) {
+        time += 1000.0 / 60;
+        settling.update(makeInteractingFrame(time, maxPoints), jobs);
+        reference.update(makeFrame(time, maxPoints), jobs);
+    }
+    float const interacted = getLargestOffset();
+
+    std::string difference;
+    float previous = interacted;
+    for (int i = 0; i < settlingFrames && difference.empty(); i++) {
+        time += 1000.0 / 60;
+        settling.update(makeFrame(time, maxPoints), jobs);
+        reference.update(makeFrame(time, maxPoints), jobs);
+        float const offset = getLargestOffset();
+        if (i == 0 && offset == 0 && interacted > 0) {
+            difference = "tracers snapped back";
+        } else if (offset > previous + 1e-3) {
+            difference = "tracers moved away at frame " + ofToString(i);
+        }
+        previous = offset;
+    }
+    if (difference.empty() && interacted == 0) {
+        difference = "tracers never moved apart";
+    } else if (difference.empty() && previous != 0) {
+        difference = "tracers still " + ofToString(previous) + " off their paths";
+    }
+
+    std::cout << "settling: " << (difference.empty() ? "ok" : "FAILED, " + difference) << std::endl;
+    return difference.empty();
+}
+
+// Interaction on one thread, where a single call covers every range, after
+// frames split across workers, against a pool that only ever ran on one.
+bool checkInteractingThreads() {
+    int const tracers = 1000;
+    int const maxPoints = 100;
+    int const frames = 60;
+    JobSystem workers(2);
+    JobSystem oneThread(1);
+    TracerPool switched(maxPoints);
+    TracerPool reference(maxPoints);
+    ofSeedRandom(1);
+    spawn(switched, tracers);
+    ofSeedRandom(1);
+    spawn(reference, tracers);
+
+    std::string difference;
+    size_t sparks = 0;
+    float time = 0;
+    for (int i = 0; i < frames && difference.empty(); i++) {
+        auto const frame = makeInteractingFrame(time += 1000.0 / 60, maxPoints);
+        switched.update(frame, i < frames / 2 ? workers : oneThread);
+        reference.update(frame, oneThread);
+        auto const& a = switched.getSparks();
+        auto const& b = reference.getSparks();
+        if (a.size() != b.size() || (!a.empty() && memcmp(&a[0], &b[0], a.size() * sizeof(a[0])) != 0)) {
+            difference = "sparks differ at frame " + ofToString(i);
+        }
+        sparks += b.size();
+    }
+    if (difference.empty()) {
+        isIdentical(switched, reference, difference);
+    }
+    if (difference.empty() && sparks == 0) {
+        difference = "no sparks to compare";
+    }
+
+    std::cout << "interactingThreads: " << (difference.empty() ? "ok" : "FAILED, " + difference) << std::endl;
+    return difference.empty();
+}
+
+// A stream from one sender to three receivers in this process: over UDP,
+// over UDP through a relay that drops every 97th datagram, and over a Unix
+// socket. Receivers must hold every head to within half a QUANTUM and, after
+// each drop, pick up again at the next keyframe.
+bool checkStream() {
+    int const tracers = 127;
+    int const ticks = 3000;
+    int const dropEvery = 97;
+    std::string const unixAddress = "unix:/tmp/tracer-check-" + ofToString(getpid());
+    std::vector<std::string> const names = {"udp", "udp dropping", "unix"};
+
+    std::vector<StreamReceiver> receivers(names.size());
+    int const relay = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_storage relayAddress;
+    socklen_t relayAddressLength;
+    sockaddr_storage lossyAddress;
+    socklen_t lossyAddressLength;
+    StreamProtocol::parseAddress("127.0.0.1:47611", relayAddress, relayAddressLength);
+    StreamProtocol::parseAddress("127.0.0.1:47612", lossyAddress, lossyAddressLength);
+    StreamSender sender;
+    if (!receivers[0].open("127.0.0.1:47610") || !receivers[1].open("127.0.0.1:47612") || !receivers[2].open(unixAddress)
+        || relay < 0 || bind(relay, reinterpret_cast<sockaddr*>(&relayAddress), relayAddressLength) != 0
+        || !sender.open({"127.0.0.1:47610", "127.0.0.1:47611", unixAddress})) {
+        std::cout << "stream: FAILED, could not open sockets" << std::endl;
+        if (relay >= 0) {
+            close(relay);
+        }
+        return false;
+    }
+    for (int i = 0; i < PROPERTY_COUNT; i++) {
+        sender.setProperty(i, 0.5);
+    }
+
+    ofSeedRandom(1);
+    std::vector<ofVec3f> heads;
+    for (int i = 0; i < tracers; i++) {
+        heads.push_back(ofVec3f(ofRandom(-350, 350), ofRandom(-350, 350), ofRandom(-350, 350)));
+    }
+    std::vector<uint8_t> datagram(StreamProtocol::MAX_DATAGRAM_BYTES);
+    int relayed = 0;
+    // The tick each receiver last missed and has not yet caught up from.
+    std::vector<uint64_t> missedSince(names.size(), 0);
+    std::vector<uint64_t> longestResync(names.size(), 0);
+    std::vector<float> largestError(names.size(), 0);
+    std::vector<uint64_t> lastTick(names.size(), 0);
+    for (int tick = 1; tick <= ticks; tick++) {
+        for (auto& head : heads) {
+            head += ofVec3f(ofRandom(-2, 2), ofRandom(-2, 2), ofRandom(-2, 2));
+        }
+        if (tick == ticks / 2) {
+            // Further than a step can go, so the sender has to keyframe.
+            heads[0] = ofVec3f(5000, 0, 0);
+        }
+        if (tick % 100 == 0) {
+            sender.setProperty(tick / 100 % PROPERTY_COUNT, tick / float(ticks));
+        }
+        sender.send(tick, tick * 1000.0 / 60, heads.data(), heads.size());
+
+        ssize_t size;
+        while ((size = recv(relay, datagram.data(), datagram.size(), MSG_DONTWAIT)) > 0) {
+            if (++relayed % dropEvery != 0) {
+                sendto(relay, datagram.data(), size, 0, reinterpret_cast<sockaddr*>(&lossyAddress), lossyAddressLength);
+            }
+        }
+
+        for (size_t r = 0; r < receivers.size(); r++) {
+            StreamReceiver::Tick received;
+            while (receivers[r].receive(received)) {
+                if (received.tick != (uint64_t)tick || received.tracerCount != heads.size()) {
+                    continue;
+                }
+                for (size_t i = 0; i < heads.size(); i++) {
+                    for (int axis = 0; axis < 3; axis++) {
+                        largestError[r] = std::max(largestError[r], std::abs(received.heads[i][axis] - heads[i][axis]));
+                    }
+                }
+                if (missedSince[r] > 0) {
+                    longestResync[r] = std::max(longestResync[r], received.tick - missedSince[r]);
+                    missedSince[r] = 0;
+                }
+                lastTick[r] = received.tick;
+            }
+            if (lastTick[r] != (uint64_t)tick && missedSince[r] == 0) {
+                missedSince[r] = tick;
+            }
+        }
+    }
+    close(relay);
+
+    auto const sent = sender.getStats();
+    std::cout << "stream, " << tracers << " tracers: " << sent.bytes / sent.ticks / names.size() << " bytes per tick, "
+        << sent.keyframes << " keyframes in " << sent.ticks << " ticks" << std::endl;
+    std::string difference;
+    for (size_t r = 0; r < receivers.size(); r++) {
+        auto const stats = receivers[r].getStats();
+        std::cout << "  " << names[r] << ": " << stats.ticks << " ticks, " << stats.lost << " lost, " << stats.skipped
+            << " skipped, largest head error " << largestError[r] << ", longest resync " << longestResync[r] << " ticks" << std::endl;
+        if (largestError[r] > StreamProtocol::QUANTUM / 2 + 1e-3) {
+            difference = names[r] + " heads drifted";
+        } else if (lastTick[r] != (uint64_t)ticks) {
+            difference = names[r] + " never caught up";
+        } else if (r != 1 && stats.lost + stats.skipped > 0) {
+            difference = names[r] + " lost ticks";
+        } else if (r == 1 && stats.lost != (uint64_t)(ticks / dropEvery)) {
+            difference = names[r] + " lost " + ofToString(stats.lost) + " ticks, not " + ofToString(ticks / dropEvery);
+        }
+    }
+    std::cout << "stream: " << (difference.empty() ? "ok" : "FAILED, " + difference) << std::endl;
+    return difference.empty();
+}
+
+}
+
+int Benchmark::runMultiplier() {
+    BatchNoise::setup();
+    JobSystem jobs(0);
+    int const maxPoints = 100;
+    float const frameMillis = 1000.0 / 60;
+
+    std::cout << "multiplierCount,tracers,maxPoints,segmentsPerFrame,legacySegmentsPerFrame,vertexBytesPerFrame,buildMillisPerFrame" << std::endl;
+    for (int multiplierCount : {0, 1, 5, 25, 100, 255}) {
+        TracerPool pool(MAX_POINTS);
+        spawn(pool, TRACER_COUNT);
+        auto const style = makeStyle(multiplierCount);
+        float time = 0;
+        for (int i = 0; i < WARM_UP_FRAMES; i++) {
+            pool.update(makeFrame(time += frameMillis, maxPoints), jobs);
+        }
+
+        auto const before = pool.getStrokeStats();
+        double buildSeconds = 0;
+        for (int i = 0; i < MEASURED_FRAMES; i++) {
+            pool.update(makeFrame(time += frameMillis, maxPoints), jobs);
+            auto const start = std::chrono::steady_clock::now();
+            pool.buildStrokes(style);
+            buildSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        auto const after = pool.getStrokeStats();
+
+        std::cout << multiplierCount << "," << TRACER_COUNT << "," << maxPoints
+            << "," << (after.segments - before.segments) / MEASURED_FRAMES
+            << "," << TRACER_COUNT * (multiplierCount + 1) * (maxPoints - 3)
+            << "," << (after.vertexBytes - before.vertexBytes) / MEASURED_FRAMES
+            << "," << buildSeconds * 1000 / MEASURED_FRAMES << std::endl;
+    }
+    return 0;
+}
+
+int Benchmark::runSuite(std::string const& path) {
+    BatchNoise::setup();
+    std::ofstream file;
+    if (!path.empty()) {
+        file.open(path);
+        if (!file) {
+            std::cerr << "Could not write " << path << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = path.empty() ? std::cout : file;
+
+    JobSystem allCores(0);
+    JobSystem oneCore(1);
+    float const frameMillis = 1000.0 / 60;
+    out << "benchmark,tracers,maxPoints,multiplierCount,threads,nanosPerRun,nanosPerTracer" << std::endl;
+
+    for (int maxPoints : SUITE_MAX_POINTS) {
+        for (int tracers : SUITE_TRACER_COUNTS) {
+            if (tracers * maxPoints > MAX_SUITE_POINTS) {
+                continue;
+            }
+            std::cerr << "Measuring " << tracers << " tracers of " << maxPoints << " points" << std::endl;
+
+            TracerPool pool(maxPoints);
+            spawn(pool, tracers);
+            float time = 0;
+            // Grow every trail to full length so each run is a steady-state frame.
+            for (int i = 0; i < maxPoints + WARM_UP_FRAMES; i++) {
+                pool.update(makeFrame(time += frameMillis, maxPoints), allCores);
+            }
+            auto const frame = [&]() {
+                return makeFrame(time += frameMillis, maxPoints);
+            };
+
+            writeRow(out, {"update", tracers, maxPoints, 0, allCores.getThreadCount()}, measure([&]() {
+                pool.update(frame(), allCores);
+            }));
+            writeRow(out, {"update", tracers, maxPoints, 0, 1}, measure([&]() {
+                pool.update(frame(), oneCore);
+            }));
+            // The same chain, unfused.
+            auto const pipeline = TracerPool::getDefaultPipeline();
+            writeRow(out, {"updatePassByPass", tracers, maxPoints, 0, 1}, measure([&]() {
+                auto const f = frame();
+                for (auto pass : pipeline) {
+                    pool.runPass(pass, f);
+                }
+            }));
+            // A chain update() cannot fuse, so it falls back to staged sweeps.
+            auto custom = pipeline;
+            custom.erase(std::find(custom.begin(), custom.end(), TracerPool::INTERACT));
+            pool.setPipeline(custom);
+            writeRow(out, {"updateCustomPipeline", tracers, maxPoints, 0, 1}, measure([&]() {
+                pool.update(frame(), oneCore);
+            }));
+            pool.setPipeline(pipeline);
+            writeRow(out, {"updateInteracting", tracers, maxPoints, 0, allCores.getThreadCount()}, measure([&]() {
+                pool.update(makeInteractingFrame(time += frameMillis, maxPoints), allCores);
+            }));
+            writeRow(out, {"interact", tracers, maxPoints, 0, 1}, measure([&]() {
+                pool.runPass(TracerPool::INTERACT, makeInteractingFrame(time, maxPoints));
+            }));
+            writeRow(out, {"moveWithPerlinNoise", tracers, maxPoints, 0, 1}, measure([&]() {
+                auto const f = frame();
+                pool.runPass(TracerPool::SET_HEADS_TO_ZERO, f);
+                pool.runPass(TracerPool::MOVE_WITH_PERLIN_NOISE, f);
+            }));
+            writeRow(out, {"projectOntoBox", tracers, maxPoints, 0, 1}, measure([&]() {
+                pool.runPass(TracerPool::PROJECT_ONTO_BOX, frame());
+            }));
+            writeRow(out, {"limitLengthAndGrowFromHeads", tracers, maxPoints, 0, 1}, measure([&]() {
+                auto const f = frame();
+                pool.runPass(TracerPool::LIMIT_LENGTH, f);
+                pool.runPass(TracerPool::GROW_FROM_HEADS, f);
+            }));
+            writeRow(out, {"tessellateStrokes", tracers, maxPoints, 0, 1}, measure([&]() {
+                auto const f = frame();
+                pool.runPass(TracerPool::LIMIT_LENGTH, f);
+                pool.runPass(TracerPool::GROW_FROM_HEADS, f);
+            }, [&]() {
+                pool.runPass(TracerPool::TESSELLATE_STROKES, makeFrame(time, maxPoints));
+            }));
+            writeRow(out, {"tessellateStrokesFromScratch", tracers, maxPoints, 0, 1}, measure([&]() {
+                pool.invalidateStrokes();
+            }, [&]() {
+                pool.runPass(TracerPool::TESSELLATE_STROKES, makeFrame(time, maxPoints));
+            }));
+
+            std::vector<ofPolyline> paths;
+            std::vector<ofVec3f> offsets;
+            for (int multiplierCount : SUITE_MULTIPLIER_COUNTS) {
+                if ((int64_t)tracers * (multiplierCount + 1) * maxPoints > MAX_SUITE_STROKE_SEGMENTS) {
+                    continue;
+                }
+                auto const style = makeStyle(multiplierCount);
+                writeRow(out, {"buildStrokes", tracers, maxPoints, multiplierCount, 1}, measure([&]() {
+                    pool.buildStrokes(style);
+                }));
+                writeRow(out, {"buildPaths", tracers, maxPoints, multiplierCount, 1}, measure([&]() {
+                    pool.buildPaths(style, paths, offsets);
+                }));
+            }
+        }
+    }
+
+    {
+        // tracerCount swept all the way down and back up, as on the encoder.
+        TracerPool pool(MAX_POINTS);
+        pool.reserve(TRACER_COUNT);
+        spawn(pool, TRACER_COUNT);
+        writeRow(out, {"spawnSweep", TRACER_COUNT, MAX_POINTS, 0, 1}, measure([&]() {
+            while (pool.size() > 1) {
+                pool.despawn();
+            }
+            spawn(pool, TRACER_COUNT - 1);
+        }));
+    }
+
+    std::vector<std::unique_ptr<property<float>>> floats;
+    std::vector<std::unique_ptr<property<ofVec3f>>> vectors;
+    int notified = 0;
+    for (int i = 0; i < PROPERTY_COUNT; i++) {
+        floats.emplace_back(new property<float>("float" + ofToString(i), 0, 0, 1));
+        floats.back()->addSubscriber([&]() { notified++; });
+        vectors.emplace_back(new property<ofVec3f>("vector" + ofToString(i), ofVec3f(0), ofVec3f(0), ofVec3f(1)));
+        vectors.back()->addSubscriber([&]() { notified++; });
+    }
+    float value = 0;
+    writeRow(out, {"propertyCleanUnchanged", 0, 0, 0, 1}, measure([&]() {
+        for (auto& p : floats) {
+            p->clean();
+        }
+    }) / PROPERTY_COUNT);
+    writeRow(out, {"propertyCleanChangedFloat", 0, 0, 0, 1}, measure([&]() {
+        value = value < 0.5 ? 0.75 : 0.25;
+        for (auto& p : floats) {
+            *p = value;
+            p->clean();
+        }
+    }) / PROPERTY_COUNT);
+    writeRow(out, {"propertyCleanChangedVec3", 0, 0, 0, 1}, measure([&]() {
+        value = value < 0.5 ? 0.75 : 0.25;
+        for (auto& p : vectors) {
+            *p = ofVec3f(value);
+            p->clean();
+        }
+    }) / PROPERTY_COUNT);
+    return 0;
+}
+
+int Benchmark::runChecks() {
+    BatchNoise::setup();
+    int failed = 0;
+    failed += !checkFusedUpdate(ofVec3f(150));
+    failed += !checkFusedUpdate(ofVec3f(0));
+    failed += !checkSpatialHash();
+    failed += !checkSettling();
+    failed += !checkInteractingThreads();
+    failed += !checkStream();
+    std::cout << failed << " checks failed" << std::endl;
+    return failed > 0 ? 1 : 0;
+}
+
+int Benchmark::compare(std::string const& baselinePath, std::string const& currentPath, float tolerance) {
+    auto const baseline = readResults(baselinePath);
+    auto const current = readResults(currentPath);
+    if (baseline.empty() || current.empty()) {
+        std::cerr << "Could not read " << (baseline.empty() ? baselinePath : currentPath) << std::endl;
+        return 1;
+    }
+
+    int regressions = 0;
+    for (auto const& result : current) {
+        auto const before = baseline.find(result.first);
+        if (before == baseline.end() || before->second <= 0) {
+            continue;
+        }
+        float const change = result.second / before->second - 1;
+        if (change > tolerance) {
+            std::cout << result.first << ": " << before->second << " -> " << result.second << " ns (+" << int(change * 100) << "%)" << std::endl;
+            regressions++;
+        }
+    }
+    std::cout << regressions << " of " << current.size() << " benchmarks regressed by more than " << int(tolerance * 100) << "%" << std::endl;
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <string>
+
+// Windowless measurements of the tracer pipeline, run from the command line.
+namespace Benchmark {
+    // Compares tessellation calls and vertex bytes per frame across
+    // multiplierCount values. Returns an exit code.
+    int runMultiplier();
+
+    // Times a whole update, fused, pass by pass, with a custom pipeline and
+    // with tracers interacting, and each update behavior in isolation
+    // across tracerCount, maxPoints and multiplierCount, plus property clean().
+    // Writes CSV to path, or to stdout if path is empty.
+    int runSuite(std::string const& path);
+
+    // Checks the update, the spatial hash and the simulation stream against
+    // slower or lossless versions they have to match, printing a line for
+    // each. Returns 1 if any fail.
+    int runChecks();
+
+    // Prints every row of current that is more than tolerance slower than
+    // the same row of baseline. Returns 1 if there are any.
+    int compare(std::string const& baselinePath, std::string const& currentPath, float tolerance);
+}
@@ -0,0 +1,26 @@
+#include "Clock.h"
+
+void Clock::setFixedStep(double seconds) {
+    step = std::max(seconds, 0.0);
+    frames = 0;
+}
+
+bool Clock::isFixed() const {
+    return step > 0;
+}
+
+void Clock::advance() {
+    frames++;
+}
+
+uint64_t Clock::getElapsedTimeMicros() const {
+    return isFixed() ? uint64_t(frames * step * 1e6 + 0.5) : ofGetElapsedTimeMicros();
+}
+
+uint64_t Clock::getElapsedTimeMillis() const {
+    return isFixed() ? getElapsedTimeMicros() / 1000 : ofGetElapsedTimeMillis();
+}
+
+float Clock::getElapsedTimef() const {
+    return isFixed() ? getElapsedTimeMicros() / 1e6 : ofGetElapsedTimef();
+}
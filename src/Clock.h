@@ -0,0 +1,22 @@
+#pragma once
+
+#include "ofMain.h"
+
+// The time update() and draw() animate against. Live it reads the wall
+// clock; with a fixed step it only moves when advance() is called, so every
+// run sees the same times no matter how long a frame takes to render.
+class Clock {
+public:
+    // seconds <= 0 goes back to the wall clock.
+    void setFixedStep(double seconds);
+    bool isFixed() const;
+    void advance();
+
+    uint64_t getElapsedTimeMicros() const;
+    uint64_t getElapsedTimeMillis() const;
+    float getElapsedTimef() const;
+
+private:
+    double step = 0;
+    uint64_t frames = 0;
+};
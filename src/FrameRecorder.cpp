@@ -0,0 +1,209 @@
+#include "FrameRecorder.h"
+#include <cstring>
+#include <fstream>
+
+FrameRecorder::FrameRecorder(int bufferCount, int threadCount) {
+    for (int i = 0; i < bufferCount; i++) {
+        frames.emplace_back(new Frame);
+        freeFrames.push_back(frames.back().get());
+    }
+    if (threadCount <= 0) {
+        threadCount = std::max<int>(std::thread::hardware_concurrency() - 1, 1);
+    }
+    for (int i = 0; i < threadCount; i++) {
+        encoders.emplace_back(&FrameRecorder::encodeLoop, this);
+    }
+}
+
+FrameRecorder::~FrameRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frameQueued.notify_all();
+    for (auto& encoder : encoders) {
+        encoder.join();
+    }
+}
+
+void FrameRecorder::start(std::string const& directory, Format format, bool dropFrames) {
+    ofDirectory::createDirectory(directory, false, true);
+    this->directory = directory;
+    this->format = format;
+    this->dropFrames = dropFrames;
+    frameIndex = 0;
+    recording = true;
+    // A recording restarted while the last one is still writing reports once, at the end.
+    finishing = false;
+}
+
+void FrameRecorder::stop() {
+    recording = false;
+    finishing = true;
+    for (auto& readback : readbacks) {
+        finishReadback(readback);
+    }
+}
+
+bool FrameRecorder::hasFinished() {
+    if (!finishing) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    finishing = !queuedFrames.empty() || encoding > 0;
+    return !finishing;
+}
+
+void FrameRecorder::waitUntilWritten() {
+    std::unique_lock<std::mutex> lock(mutex);
+    frameFreed.wait(lock, [&]() { return queuedFrames.empty() && encoding == 0; });
+}
+
+bool FrameRecorder::isRecording() const {
+    return recording;
+}
+
+void FrameRecorder::screenshot(std::string const& path) {
+    screenshotPath = path;
+}
+
+bool FrameRecorder::isCapturing() const {
+    return recording || !screenshotPath.empty();
+}
+
+std::string FrameRecorder::getFramePath(uint64_t index) const {
+    char name[32];
+    snprintf(name, sizeof(name), "frame_%06llu.%s", (unsigned long long)index, format == PNG_SEQUENCE ? "png" : "rgba");
+    return directory + "/" + name;
+}
+
+void FrameRecorder::capture(int width, int height) {
+    if (!isCapturing() || width <= 0 || height <= 0) {
+        // Collect a screenshot taken last frame.
+        for (auto& readback : readbacks) {
+            finishReadback(readback);
+        }
+        return;
+    }
+
+    if (width != this->width || height != this->height) {
+        for (auto& readback : readbacks) {
+            finishReadback(readback);
+            readback.buffer.allocate(width * height * 4, GL_STREAM_READ);
+        }
+        this->width = width;
+        this->height = height;
+    }
+
+    // Start this frame's readback, then collect the one from a frame ago.
+    auto& readback = readbacks[nextReadback];
+    finishReadback(readback);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    readback.buffer.bind(GL_PIXEL_PACK_BUFFER);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    readback.buffer.unbind(GL_PIXEL_PACK_BUFFER);
+    readback.pending = true;
+    readback.requests.clear();
+    if (recording) {
+        readback.requests.push_back({getFramePath(frameIndex++), format, dropFrames});
+    }
+    if (!screenshotPath.empty()) {
+        readback.requests.push_back({screenshotPath, PNG_SEQUENCE, false});
+        screenshotPath.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.captured++;
+    }
+
+    nextReadback = (nextReadback + 1) % 2;
+    finishReadback(readbacks[nextReadback]);
+}
+
+void FrameRecorder::finishReadback(Readback& readback) {
+    if (!readback.pending) {
+        return;
+    }
+    readback.pending = false;
+
+    std::vector<Frame*> targets;
+    for (auto const& request : readback.requests) {
+        Frame* frame = acquireFrame(!request.droppable);
+        if (frame == nullptr) {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.dropped++;
+            continue;
+        }
+        frame->path = request.path;
+        frame->format = request.format;
+        targets.push_back(frame);
+    }
+    if (targets.empty()) {
+        return;
+    }
+
+    auto const data = readback.buffer.map<unsigned char>(GL_READ_ONLY);
+    for (auto frame : targets) {
+        frame->pixels.allocate(width, height, 4);
+        memcpy(frame->pixels.getData(), data, width * height * 4);
+    }
+    readback.buffer.unmap();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto frame : targets) {
+            queuedFrames.push_back(frame);
+        }
+    }
+    frameQueued.notify_all();
+}
+
+FrameRecorder::Frame* FrameRecorder::acquireFrame(bool wait) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (wait) {
+        frameFreed.wait(lock, [&]() { return !freeFrames.empty(); });
+    } else if (freeFrames.empty()) {
+        return nullptr;
+    }
+    Frame* frame = freeFrames.back();
+    freeFrames.pop_back();
+    return frame;
+}
+
+void FrameRecorder::encodeLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        frameQueued.wait(lock, [&]() { return stopping || !queuedFrames.empty(); });
+        if (queuedFrames.empty()) {
+            return;
+        }
+        Frame* frame = queuedFrames.front();
+        queuedFrames.pop_front();
+        encoding++;
+
+        lock.unlock();
+        writeFrame(*frame);
+        lock.lock();
+
+        encoding--;
+        stats.written++;
+        freeFrames.push_back(frame);
+        frameFreed.notify_all();
+    }
+}
+
+void FrameRecorder::writeFrame(Frame& frame) {
+    // glReadPixels returns the bottom row first.
+    frame.pixels.mirror(true, false);
+    if (frame.format == PNG_SEQUENCE) {
+        ofSaveImage(frame.pixels, frame.path);
+    } else {
+        std::ofstream file(frame.path, std::ios::binary);
+        file.write((char const*)frame.pixels.getData(), frame.pixels.size());
+    }
+}
+
+FrameRecorder::Stats FrameRecorder::getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
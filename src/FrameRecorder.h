@@ -0,0 +1,100 @@
+#pragma once
+
+#include "ofMain.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Saves rendered frames without stalling the frame that drew them. Each
+// capture starts an asynchronous readback into one of two pixel buffer
+// objects and maps the other, which the GPU filled a frame ago. The pixels
+// go to a fixed pool of frame buffers and on to encoder threads. When every
+// buffer is busy the frame is dropped, unless the recording was started
+// without dropping, as an offline render is.
+class FrameRecorder {
+public:
+    enum Format {
+        PNG_SEQUENCE,
+        // Unencoded RGBA, one .rgba file per frame, top row first.
+        RAW_SEQUENCE
+    };
+
+    struct Stats {
+        uint64_t captured = 0;
+        uint64_t dropped = 0;
+        uint64_t written = 0;
+    };
+
+    // threadCount 0 leaves one core for the app.
+    FrameRecorder(int bufferCount = 8, int threadCount = 0);
+    ~FrameRecorder();
+
+    void start(std::string const& directory, Format format, bool dropFrames = true);
+    // Stops capturing without waiting: the encoder threads go on writing
+    // what is already captured.
+    void stop();
+    bool isRecording() const;
+    // Main thread, once a frame: true once after stop(), when the last
+    // frame of the recording has been written.
+    bool hasFinished();
+    // Blocks until every captured frame is written.
+    void waitUntilWritten();
+    // Saves the next captured frame to path as well.
+    void screenshot(std::string const& path);
+    bool isCapturing() const;
+
+    // Main thread, after drawing: reads the bound framebuffer.
+    void capture(int width, int height);
+    Stats getStats() const;
+
+private:
+    struct Frame {
+        ofPixels pixels;
+        std::string path;
+        Format format;
+    };
+
+    struct Request {
+        std::string path;
+        Format format;
+        bool droppable;
+    };
+
+    struct Readback {
+        ofBufferObject buffer;
+        bool pending = false;
+        std::vector<Request> requests;
+    };
+
+    void finishReadback(Readback& readback);
+    Frame* acquireFrame(bool wait);
+    void encodeLoop();
+    static void writeFrame(Frame& frame);
+    std::string getFramePath(uint64_t index) const;
+
+    Readback readbacks[2];
+    int nextReadback = 0;
+    int width = 0;
+    int height = 0;
+
+    bool recording = false;
+    // Stopped, with frames still being written.
+    bool finishing = false;
+    bool dropFrames = true;
+    std::string directory;
+    Format format = PNG_SEQUENCE;
+    uint64_t frameIndex = 0;
+    std::string screenshotPath;
+
+    std::vector<std::unique_ptr<Frame>> frames;
+    std::vector<std::thread> encoders;
+    mutable std::mutex mutex;
+    std::condition_variable frameQueued;
+    std::condition_variable frameFreed;
+    std::vector<Frame*> freeFrames;
+    std::deque<Frame*> queuedFrames;
+    int encoding = 0;
+    bool stopping = false;
+    Stats stats;
+};
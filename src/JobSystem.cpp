@@ -0,0 +1,125 @@
+#include "JobSystem.h"
+
+JobSystem::JobSystem(int threadCount) : remaining(0) {
+    startWorkers(threadCount);
+}
+
+JobSystem::~JobSystem() {
+    stopWorkers();
+}
+
+void JobSystem::setThreadCount(int threadCount) {
+    stopWorkers();
+    startWorkers(threadCount);
+}
+
+int JobSystem::getThreadCount() const {
+    return queues.size();
+}
+
+void JobSystem::startWorkers(int threadCount) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    stopping = false;
+    for (int i = 0; i < threadCount; i++) {
+        queues.emplace_back(new Queue);
+    }
+    for (int i = 1; i < threadCount; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+void JobSystem::stopWorkers() {
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+    queues.clear();
+}
+
+void JobSystem::parallelFor(size_t count, size_t grainSize, Job const& job) {
+    if (count == 0) {
+        return;
+    }
+
+    grainSize = std::max<size_t>(grainSize, 1);
+    if (workers.empty() || count <= grainSize) {
+        job(0, count);
+        return;
+    }
+
+    this->job = &job;
+    size_t const rangeCount = (count + grainSize - 1) / grainSize;
+    remaining.store(rangeCount);
+    for (size_t i = 0; i < rangeCount; i++) {
+        auto& queue = *queues[i % queues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.ranges.push_back({i * grainSize, std::min(count, (i + 1) * grainSize)});
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(wakeMutex);
+        generation++;
+    }
+    wake.notify_all();
+
+    runRanges(0);
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        std::this_thread::yield();
+    }
+    this->job = nullptr;
+}
+
+void JobSystem::workerLoop(int queueIndex) {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+        runRanges(queueIndex);
+    }
+}
+
+void JobSystem::runRanges(int queueIndex) {
+    Range range;
+    while (popOrSteal(queueIndex, range)) {
+        (*job)(range.begin, range.end);
+        remaining.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+bool JobSystem::popOrSteal(int queueIndex, Range& range) {
+    {
+        auto& own = *queues[queueIndex];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.ranges.empty()) {
+            range = own.ranges.back();
+            own.ranges.pop_back();
+            return true;
+        }
+    }
+
+    size_t const queueCount = queues.size();
+    for (size_t offset = 1; offset < queueCount; offset++) {
+        auto& victim = *queues[(queueIndex + offset) % queueCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.ranges.empty()) {
+            range = victim.ranges.front();
+            victim.ranges.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Splits index ranges across a fixed set of worker threads. Every thread,
+// including the caller, owns a queue of ranges; idle threads steal from the
+// front of other queues while owners pop from the back.
+class JobSystem {
+public:
+    typedef std::function<void(size_t begin, size_t end)> Job;
+
+    JobSystem(int threadCount = 1);
+    ~JobSystem();
+
+    // Counts the calling thread. 1 runs every job inline, 0 uses every core.
+    void setThreadCount(int threadCount);
+    int getThreadCount() const;
+
+    // Blocks until job has run over every range of [0, count).
+    void parallelFor(size_t count, size_t grainSize, Job const& job);
+
+private:
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Range> ranges;
+    };
+
+    void startWorkers(int threadCount);
+    void stopWorkers();
+    void workerLoop(int queueIndex);
+    void runRanges(int queueIndex);
+    bool popOrSteal(int queueIndex, Range& range);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<Queue>> queues;
+    Job const* job = nullptr;
+    std::atomic<size_t> remaining;
+
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    uint64_t generation = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,67 @@
+#include "MidiLog.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+bool MidiLog::load(std::string const& path) {
+    std::ifstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    entries.clear();
+    next = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream fields(line);
+        Entry entry;
+        int control;
+        if (!(fields >> entry.micros >> control >> entry.id >> entry.value) || control < 0 || control >= MidiQueue::CONTROL_COUNT) {
+            std::cerr << "MidiLog: skipping malformed line in " << path << ": " << line << std::endl;
+            continue;
+        }
+        entry.control = (MidiQueue::Control)control;
+        entries.push_back(entry);
+    }
+    std::stable_sort(entries.begin(), entries.end(), [](Entry const& a, Entry const& b) { return a.micros < b.micros; });
+    return true;
+}
+
+bool MidiLog::isReplaying() const {
+    return next < entries.size();
+}
+
+void MidiLog::replay(uint64_t micros, MidiQueue& queue, uint64_t nanos) {
+    for (; next < entries.size() && entries[next].micros <= micros; next++) {
+        queue.push(entries[next].control, entries[next].id, entries[next].value, nanos);
+    }
+}
+
+bool MidiLog::startRecording(std::string const& path) {
+    recording.close();
+    recording.clear();
+    recording.open(path, std::ios::trunc);
+    if (!recording) {
+        return false;
+    }
+    recording << "# micros,control,id,value; control 0 encoder, 1 push switch, 2 side button" << std::endl;
+    return true;
+}
+
+void MidiLog::stopRecording() {
+    recording.close();
+}
+
+bool MidiLog::isRecording() const {
+    return recording.is_open();
+}
+
+void MidiLog::record(uint64_t micros, MidiQueue::Event const& event) {
+    if (recording.is_open()) {
+        recording << micros << "," << event.control << "," << event.id << "," << event.value << "\n";
+    }
+}
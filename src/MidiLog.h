@@ -0,0 +1,34 @@
+#pragma once
+
+#include "MidiQueue.h"
+#include <fstream>
+#include <string>
+
+// Controller events as applied, one "micros,control,id,value" line each,
+// timed by the app clock. Replaying a log pushes each event in the first
+// frame at or after its time, so an offline render replays a performance
+// exactly and a log written by hand can stand in for the Twister.
+class MidiLog {
+public:
+    struct Entry {
+        uint64_t micros;
+        MidiQueue::Control control;
+        int id;
+        int value;
+    };
+
+    bool load(std::string const& path);
+    bool isReplaying() const;
+    // Pushes every entry due by micros into queue, stamped with nanos.
+    void replay(uint64_t micros, MidiQueue& queue, uint64_t nanos);
+
+    bool startRecording(std::string const& path);
+    void stopRecording();
+    bool isRecording() const;
+    void record(uint64_t micros, MidiQueue::Event const& event);
+
+private:
+    std::vector<Entry> entries;
+    size_t next = 0;
+    std::ofstream recording;
+};
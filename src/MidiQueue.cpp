@@ -0,0 +1,49 @@
+#include "MidiQueue.h"
+
+MidiQueue::MidiQueue() {
+    for (int i = 0; i < SLOT_COUNT; i++) {
+        states[i] = 0;
+        firstNanos[i] = 0;
+    }
+}
+
+void MidiQueue::push(Control control, int id, int value, uint64_t nanos) {
+    if (control < 0 || control >= CONTROL_COUNT || id < 0 || id >= MAX_ID) {
+        return;
+    }
+
+    int const slot = control * MAX_ID + id;
+    uint64_t state = states[slot].load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        if (!(state & PENDING)) {
+            firstNanos[slot].store(nanos, std::memory_order_relaxed);
+        }
+        uint64_t const messages = (state & PENDING ? state >> COUNT_SHIFT : 0) + 1;
+        next = (messages << COUNT_SHIFT) | PENDING | ((uint64_t)value & VALUE_MASK);
+    } while (!states[slot].compare_exchange_weak(state, next, std::memory_order_release, std::memory_order_relaxed));
+    messageCount.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MidiQueue::drain(std::vector<Event>& events) {
+    events.clear();
+    for (int slot = 0; slot < SLOT_COUNT; slot++) {
+        if (!(states[slot].load(std::memory_order_acquire) & PENDING)) {
+            continue;
+        }
+        // Pushers leave firstNanos alone until the flag is cleared below.
+        uint64_t const nanos = firstNanos[slot].load(std::memory_order_relaxed);
+        uint64_t const state = states[slot].exchange(0, std::memory_order_acq_rel);
+        Event event;
+        event.control = (Control)(slot / MAX_ID);
+        event.id = slot % MAX_ID;
+        event.value = state & VALUE_MASK;
+        event.nanos = nanos;
+        event.messages = state >> COUNT_SHIFT;
+        events.push_back(event);
+    }
+}
+
+uint64_t MidiQueue::getMessageCount() const {
+    return messageCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Hands controller events from MIDI callbacks to the main thread. Each
+// control keeps only its newest value until the main thread drains it, so
+// a fast encoder spin costs one update a frame however many messages it
+// sends. push() never locks or allocates and is safe from any thread.
+class MidiQueue {
+public:
+    enum Control {
+        ENCODER,
+        PUSH_SWITCH,
+        SIDE_BUTTON,
+        CONTROL_COUNT
+    };
+
+    static int const MAX_ID = 64;
+
+    struct Event {
+        Control control;
+        int id;
+        int value;
+        // When the oldest message folded into this event arrived.
+        uint64_t nanos;
+        uint32_t messages;
+    };
+
+    MidiQueue();
+
+    // value is 0-65535; nanos is the caller's clock at arrival.
+    void push(Control control, int id, int value, uint64_t nanos);
+    // Main thread: replaces events with every control changed since the last drain.
+    void drain(std::vector<Event>& events);
+    uint64_t getMessageCount() const;
+
+private:
+    // Each slot's state packs the newest value, a pending flag and the
+    // number of messages since the last drain.
+    static uint64_t const VALUE_MASK = 0xffff;
+    static uint64_t const PENDING = 1 << 16;
+    static int const COUNT_SHIFT = 17;
+    static int const SLOT_COUNT = CONTROL_COUNT * MAX_ID;
+
+    std::atomic<uint64_t> states[SLOT_COUNT];
+    // Written only while the slot is not pending, so it dates the whole batch.
+    std::atomic<uint64_t> firstNanos[SLOT_COUNT];
+    std::atomic<uint64_t> messageCount = {0};
+};
@@ -0,0 +1,61 @@
+#include "OfflineRender.h"
+
+namespace {
+
+void printUsage() {
+    std::cerr << "usage: Tracer --render frames [--fps n] [--seed n] [--size WxH] [--out dir] [--midi file] [--strokes mesh|shivavg|gl]" << std::endl;
+}
+
+}
+
+bool OfflineRender::isEnabled() const {
+    return frames > 0;
+}
+
+bool OfflineRender::parse(int argc, char* argv[], OfflineRender& render) {
+    if (argc < 2 || std::string(argv[1]) != "--render") {
+        return true;
+    }
+    if (argc < 3 || (render.frames = atoi(argv[2])) <= 0) {
+        printUsage();
+        return false;
+    }
+
+    for (int i = 3; i < argc; i += 2) {
+        std::string const option = argv[i];
+        if (i + 1 >= argc) {
+            printUsage();
+            return false;
+        }
+        std::string const value = argv[i + 1];
+        if (option == "--fps") {
+            render.framesPerSecond = atof(value.c_str());
+        } else if (option == "--seed") {
+            render.seed = strtoul(value.c_str(), nullptr, 10);
+        } else if (option == "--size") {
+            if (sscanf(value.c_str(), "%dx%d", &render.width, &render.height) != 2) {
+                printUsage();
+                return false;
+            }
+        } else if (option == "--out") {
+            render.outputDirectory = value;
+        } else if (option == "--midi") {
+            render.midiFile = value;
+        } else if (option == "--strokes") {
+            render.strokeBackend = StrokeMesh::findBackend(value);
+            if (render.strokeBackend == StrokeMesh::BACKEND_COUNT) {
+                printUsage();
+                return false;
+            }
+        } else {
+            printUsage();
+            return false;
+        }
+    }
+
+    if (render.framesPerSecond <= 0 || render.width <= 0 || render.height <= 0) {
+        printUsage();
+        return false;
+    }
+    return true;
+}
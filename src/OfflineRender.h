@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ofMain.h"
+#include "StrokeMesh.h"
+
+// Settings for rendering a fixed number of frames to an image sequence in
+// a hidden window, on a simulated clock and a seeded random generator.
+struct OfflineRender {
+    int frames = 0;
+    float framesPerSecond = 60;
+    unsigned int seed = 1;
+    int width = 700;
+    int height = 700;
+    std::string outputDirectory = "render";
+    // Controller events to replay; see MidiLog.
+    std::string midiFile;
+    // Overrides settings.xml's strokeBackend unless BACKEND_COUNT.
+    StrokeMesh::Backend strokeBackend = StrokeMesh::BACKEND_COUNT;
+
+    bool isEnabled() const;
+
+    // Reads "--render frames [--fps n] [--seed n] [--size WxH] [--out dir]
+    // [--midi file] [--strokes mesh|shivavg|gl]".
+    // Returns false and prints usage if argv asks for a render but is malformed.
+    static bool parse(int argc, char* argv[], OfflineRender& render);
+};
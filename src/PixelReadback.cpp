@@ -0,0 +1,36 @@
+#include "PixelReadback.h"
+#include <chrono>
+
+PixelReadback::Pixels PixelReadback::read(int width, int height, GLenum format) {
+    release();
+    size_t const size = width * height * 4;
+    auto& buffer = buffers[next];
+    if (sizes[next] != size) {
+        buffer.allocate(size, GL_STREAM_READ);
+        sizes[next] = size;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    buffer.bind(GL_PIXEL_PACK_BUFFER);
+    glReadPixels(0, 0, width, height, format, GL_UNSIGNED_BYTE, 0);
+    buffer.unbind(GL_PIXEL_PACK_BUFFER);
+    started[next].width = width;
+    started[next].height = height;
+    started[next].readNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    next = 1 - next;
+    Pixels pixels = started[next];
+    started[next] = Pixels();
+    if (pixels.width == 0) {
+        return Pixels();
+    }
+    pixels.data = buffers[next].map<unsigned char>(GL_READ_ONLY);
+    mapped = next;
+    return pixels;
+}
+
+void PixelReadback::release() {
+    if (mapped >= 0) {
+        buffers[mapped].unmap();
+        mapped = -1;
+    }
+}
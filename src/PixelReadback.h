@@ -0,0 +1,29 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Double-buffered asynchronous glReadPixels. Each read() starts reading the
+// bound framebuffer into one pixel buffer object and maps the other, which
+// the GPU has had a whole frame to fill, so neither side waits on the other.
+class PixelReadback {
+public:
+    struct Pixels {
+        unsigned char const* data = nullptr;
+        int width = 0;
+        int height = 0;
+        // steady_clock nanoseconds when the frame was read.
+        uint64_t readNanos = 0;
+    };
+
+    // Returns last frame's pixels, empty on the first call. They stay valid
+    // until release(), which must come before the next read().
+    Pixels read(int width, int height, GLenum format);
+    void release();
+
+private:
+    ofBufferObject buffers[2];
+    size_t sizes[2] = {0, 0};
+    Pixels started[2];
+    int next = 0;
+    int mapped = -1;
+};
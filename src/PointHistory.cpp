@@ -0,0 +1,89 @@
+#include "PointHistory.h"
+
+PointHistory::PointHistory(int capacity) : capacity(capacity) {
+}
+
+void PointHistory::addTracer() {
+    points.resize(points.size() + capacity);
+    starts.push_back(0);
+    counts.push_back(0);
+    pushed.push_back(0);
+}
+
+void PointHistory::removeTracer() {
+    if (counts.empty()) {
+        return;
+    }
+
+    points.resize(points.size() - capacity);
+    starts.pop_back();
+    counts.pop_back();
+    pushed.pop_back();
+}
+
+int PointHistory::getCapacity() const {
+    return capacity;
+}
+
+size_t PointHistory::size(size_t tracer) const {
+    return counts[tracer];
+}
+
+void PointHistory::push(size_t tracer, ofVec3f const& point) {
+    int& start = starts[tracer];
+    int& count = counts[tracer];
+    int slot = start + count;
+    if (slot >= capacity) {
+        slot -= capacity;
+    }
+    points[tracer * capacity + slot] = point;
+    pushed[tracer]++;
+
+    if (count < capacity) {
+        count++;
+    } else if (++start == capacity) {
+        start = 0;
+    }
+}
+
+void PointHistory::trim(size_t tracer, int maxCount) {
+    int& count = counts[tracer];
+    int const excess = count - std::max(maxCount, 0);
+    if (excess > 0) {
+        starts[tracer] = (starts[tracer] + excess) % capacity;
+        count -= excess;
+    }
+}
+
+void PointHistory::clear(size_t tracer) {
+    starts[tracer] = 0;
+    counts[tracer] = 0;
+}
+
+PointSpans PointHistory::spans(size_t tracer) const {
+    ofVec3f const* ring = points.data() + tracer * capacity;
+    int const start = starts[tracer];
+    int const count = counts[tracer];
+    int const firstSize = std::min(count, capacity - start);
+    return {{ring + start, (size_t)firstSize}, {ring, (size_t)(count - firstSize)}};
+}
+
+ofVec3f const& PointHistory::newest(size_t tracer) const {
+    int slot = starts[tracer] + counts[tracer] - 1;
+    if (slot >= capacity) {
+        slot -= capacity;
+    }
+    return points[tracer * capacity + slot];
+}
+
+ofVec3f const& PointHistory::at(size_t tracer, size_t index) const {
+    size_t slot = starts[tracer] + index;
+    if (slot >= (size_t)capacity) {
+        slot -= capacity;
+    }
+    return points[tracer * capacity + slot];
+}
+
+uint64_t PointHistory::getPushed(size_t tracer) const {
+    return pushed[tracer];
+}
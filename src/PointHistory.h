@@ -0,0 +1,55 @@
+#pragma once
+
+#include "ofMain.h"
+
+// A contiguous run of points.
+struct PointSpan {
+    ofVec3f const* data;
+    size_t size;
+
+    ofVec3f const* begin() const { return data; }
+    ofVec3f const* end() const { return data + size; }
+};
+
+// Oldest-to-newest view of one tracer's history. The ring may wrap, so the
+// points are first followed by second.
+struct PointSpans {
+    PointSpan first;
+    PointSpan second;
+
+    size_t size() const { return first.size + second.size; }
+    ofVec3f const& operator[](size_t index) const {
+        return index < first.size ? first.data[index] : second.data[index - first.size];
+    }
+};
+
+// Point histories for every tracer in one slab, each a fixed-capacity ring.
+// Capacity is set once from the largest maxPoints, so trimming, growing and
+// turning maxPoints up or down never touch the allocator.
+class PointHistory {
+public:
+    PointHistory(int capacity);
+
+    void addTracer();
+    void removeTracer();
+    int getCapacity() const;
+
+    size_t size(size_t tracer) const;
+    void push(size_t tracer, ofVec3f const& point);
+    // Drops the oldest points until at most maxCount remain.
+    void trim(size_t tracer, int maxCount);
+    void clear(size_t tracer);
+    PointSpans spans(size_t tracer) const;
+    ofVec3f const& newest(size_t tracer) const;
+    // index counts from the oldest point still held.
+    ofVec3f const& at(size_t tracer, size_t index) const;
+    // Points ever pushed, so the oldest held point is number getPushed() - size().
+    uint64_t getPushed(size_t tracer) const;
+
+private:
+    int const capacity;
+    std::vector<ofVec3f> points;
+    std::vector<int> starts;
+    std::vector<int> counts;
+    std::vector<uint64_t> pushed;
+};
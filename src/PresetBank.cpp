@@ -0,0 +1,226 @@
+#include "PresetBank.h"
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+PresetBank::PresetBank() {
+    flusher = std::thread(&PresetBank::flushInBackground, this);
+}
+
+PresetBank::~PresetBank() {
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        stopping = true;
+    }
+    flushRequested.notify_one();
+    flusher.join();
+    close();
+}
+
+std::vector<char> PresetBank::makeFile(std::vector<std::string> const& names) {
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.propertyCount = names.size();
+    header.presetCount = CAPACITY;
+    header.presetOffset = sizeof(Header) + names.size() * NAME_BYTES;
+    header.presetBytes = sizeof(uint32_t) + names.size() * sizeof(float);
+
+    std::vector<char> file(header.presetOffset + CAPACITY * header.presetBytes, 0);
+    memcpy(file.data(), &header, sizeof(Header));
+    for (size_t i = 0; i < names.size(); i++) {
+        strncpy(&file[sizeof(Header) + i * NAME_BYTES], names[i].c_str(), NAME_BYTES - 1);
+    }
+    return file;
+}
+
+std::vector<std::string> PresetBank::readNames(char const* file, size_t size) {
+    std::vector<std::string> names;
+    if (size < sizeof(Header)) {
+        return names;
+    }
+    Header header;
+    memcpy(&header, file, sizeof(Header));
+    bool const valid = header.magic == MAGIC && header.version == VERSION
+        && header.presetOffset == sizeof(Header) + (uint64_t)header.propertyCount * NAME_BYTES
+        && header.presetBytes == sizeof(uint32_t) + (uint64_t)header.propertyCount * sizeof(float)
+        && header.presetOffset + header.presetCount * header.presetBytes <= size;
+    if (!valid) {
+        return names;
+    }
+    for (uint32_t i = 0; i < header.propertyCount; i++) {
+        char const* name = file + sizeof(Header) + i * NAME_BYTES;
+        names.push_back(std::string(name, strnlen(name, NAME_BYTES)));
+    }
+    return names;
+}
+
+bool PresetBank::open(std::string const& path, std::vector<property_base*> const& properties, bool persist) {
+    close();
+    std::vector<std::string> names;
+    for (auto property : properties) {
+        names.push_back(property->getName().substr(0, NAME_BYTES - 1));
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    std::vector<char> old((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    auto const oldNames = readNames(old.data(), old.size());
+    Header oldHeader = {};
+    memcpy(&oldHeader, old.data(), oldNames.empty() ? 0 : sizeof(Header));
+    std::vector<char> migrated;
+    if (oldNames != names || oldHeader.presetCount != CAPACITY) {
+        // Rewrite the file for the current properties, carrying over every
+        // column that still has a property with the same name.
+        auto file = makeFile(names);
+        Header header;
+        memcpy(&header, file.data(), sizeof(Header));
+        int const presets = oldNames.empty() ? 0 : std::min<int>(oldHeader.presetCount, CAPACITY);
+        for (int preset = 0; preset < presets; preset++) {
+            char const* from = &old[oldHeader.presetOffset + preset * oldHeader.presetBytes];
+            char* to = &file[header.presetOffset + preset * header.presetBytes];
+            memcpy(to, from, sizeof(uint32_t));
+            for (size_t i = 0; i < names.size(); i++) {
+                float scale = NAN;
+                auto const column = std::find(oldNames.begin(), oldNames.end(), names[i]);
+                if (column != oldNames.end()) {
+                    memcpy(&scale, from + sizeof(uint32_t) + (column - oldNames.begin()) * sizeof(float), sizeof(float));
+                }
+                memcpy(to + sizeof(uint32_t) + i * sizeof(float), &scale, sizeof(float));
+            }
+        }
+
+        if (!persist) {
+            migrated = std::move(file);
+        } else {
+            std::string const temporary = path + ".tmp";
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(file.data(), file.size());
+            out.close();
+            if (!out || rename(temporary.c_str(), path.c_str()) != 0) {
+                ofLogError("PresetBank") << "Could not write " << path;
+                return false;
+            }
+            if (!oldNames.empty()) {
+                ofLogNotice("PresetBank") << "Migrated " << path << " to " << names.size() << " properties";
+            }
+        }
+    }
+
+    void* memory = MAP_FAILED;
+    size_t mappedSize = 0;
+    if (!migrated.empty()) {
+        // Nothing on disk to map, so the bank lives in anonymous memory.
+        mappedSize = migrated.size();
+        memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (memory != MAP_FAILED) {
+            memcpy(memory, migrated.data(), mappedSize);
+        }
+    } else {
+        int const fd = ::open(path.c_str(), persist ? O_RDWR : O_RDONLY);
+        if (fd < 0) {
+            ofLogError("PresetBank") << "open " << path << ": " << strerror(errno);
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) == 0) {
+            mappedSize = info.st_size;
+            // A private mapping is copy-on-write, so stores never reach the file.
+            memory = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, persist ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+        }
+        ::close(fd);
+    }
+    if (memory == MAP_FAILED) {
+        ofLogError("PresetBank") << "mapping " << path << ": " << strerror(errno);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mapMutex);
+    file = (char*)memory;
+    size = mappedSize;
+    propertyCount = names.size();
+    // Fault every page in now rather than on the first recall.
+    long const page = sysconf(_SC_PAGESIZE);
+    volatile char sum = 0;
+    for (size_t offset = 0; offset < size; offset += page) {
+        sum += file[offset];
+    }
+    return true;
+}
+
+void PresetBank::close() {
+    std::lock_guard<std::mutex> lock(mapMutex);
+    if (file == nullptr) {
+        return;
+    }
+    msync(file, size, MS_SYNC);
+    munmap(file, size);
+    file = nullptr;
+    size = 0;
+    propertyCount = 0;
+}
+
+bool PresetBank::isOpen() const {
+    return file != nullptr;
+}
+
+char* PresetBank::getPreset(int preset) const {
+    Header const* header = (Header const*)file;
+    return file + header->presetOffset + preset * header->presetBytes;
+}
+
+bool PresetBank::has(int preset) const {
+    if (file == nullptr || preset < 0 || preset >= CAPACITY) {
+        return false;
+    }
+    uint32_t stored;
+    memcpy(&stored, getPreset(preset), sizeof(uint32_t));
+    return stored != 0;
+}
+
+float const* PresetBank::get(int preset) const {
+    return has(preset) ? (float const*)(getPreset(preset) + sizeof(uint32_t)) : nullptr;
+}
+
+void PresetBank::store(int preset, std::vector<property_base*> const& properties) {
+    if (file == nullptr || preset < 0 || preset >= CAPACITY || properties.size() != propertyCount) {
+        return;
+    }
+
+    char* record = getPreset(preset);
+    float* scales = (float*)(record + sizeof(uint32_t));
+    for (size_t i = 0; i < propertyCount; i++) {
+        scales[i] = properties[i]->getScale();
+    }
+    uint32_t const stored = 1;
+    memcpy(record, &stored, sizeof(uint32_t));
+
+    {
+        std::lock_guard<std::mutex> lock(flushMutex);
+        flushPending = true;
+    }
+    flushRequested.notify_one();
+}
+
+void PresetBank::flushInBackground() {
+    std::unique_lock<std::mutex> lock(flushMutex);
+    while (true) {
+        flushRequested.wait(lock, [&]() { return flushPending || stopping; });
+        if (stopping) {
+            return;
+        }
+        flushPending = false;
+        lock.unlock();
+        {
+            std::lock_guard<std::mutex> mapLock(mapMutex);
+            if (file != nullptr) {
+                msync(file, size, MS_SYNC);
+            }
+        }
+        lock.lock();
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ofxBenG.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Scenes for live recall, kept in a memory-mapped binary file. A preset is
+// the scale of every performance property, one float per property in the
+// order given to open(), which is also their property handle order in
+// ofApp. Reading a preset is reading the mapping, so recall never touches
+// the disk; store() writes into the mapping and a background thread flushes
+// it. The file names its columns, so adding or reordering properties keeps
+// the presets already stored.
+class PresetBank {
+public:
+    static int const CAPACITY = 128;
+
+    PresetBank();
+    ~PresetBank();
+
+    // Maps path, creating it or migrating it to properties as needed.
+    // Unless persist, the file is left untouched and stores only last
+    // until close(), as a replayed session needs.
+    bool open(std::string const& path, std::vector<property_base*> const& properties, bool persist = true);
+    bool isOpen() const;
+    bool has(int preset) const;
+    // One scale per property; NaN for properties the preset predates.
+    float const* get(int preset) const;
+    // Main thread; returns before the preset reaches the disk.
+    void store(int preset, std::vector<property_base*> const& properties);
+
+private:
+    static uint32_t const MAGIC = 0x42505254; // "TRPB"
+    static uint32_t const VERSION = 1;
+    static int const NAME_BYTES = 32;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t propertyCount;
+        uint32_t presetCount;
+        uint64_t presetOffset;
+        uint64_t presetBytes;
+    };
+
+    // Each preset is a uint32_t stored flag followed by the scales.
+    static std::vector<char> makeFile(std::vector<std::string> const& names);
+    static std::vector<std::string> readNames(char const* file, size_t size);
+    char* getPreset(int preset) const;
+    void close();
+    void flushInBackground();
+
+    char* file = nullptr;
+    size_t size = 0;
+    size_t propertyCount = 0;
+
+    // Held while the mapping is flushed or replaced.
+    std::mutex mapMutex;
+    std::thread flusher;
+    std::mutex flushMutex;
+    std::condition_variable flushRequested;
+    bool flushPending = false;
+    bool stopping = false;
+};
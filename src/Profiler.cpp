@@ -0,0 +1,272 @@
+#include "Profiler.h"
+#include <fstream>
+
+namespace {
+
+std::atomic<uint64_t> nextProfilerId = {1};
+
+struct ThreadCache {
+    uint64_t profilerId = 0;
+    void* buffer = nullptr;
+    // Keeps the buffer alive, and hands it back when the thread exits or
+    // moves to another profiler.
+    std::shared_ptr<std::atomic<bool>> inUse;
+
+    void release() {
+        if (inUse) {
+            inUse->store(false, std::memory_order_release);
+            inUse.reset();
+        }
+    }
+
+    ~ThreadCache() {
+        release();
+    }
+};
+
+thread_local ThreadCache threadCache;
+
+char const* const PHASE_NAMES[] = {
+    "frame", "clean", "easing", "spawn", "tracerUpdate", "tracerJob", "interaction", "draw", "boxDraw", "videoOutput", "midiToFrame", "tickToDraw"
+};
+
+}
+
+Profiler::Scope::Scope(Profiler* profiler, Phase phase) : profiler(profiler), phase(phase) {
+    start = profiler != nullptr ? profiler->now() : 0;
+}
+
+Profiler::Scope::~Scope() {
+    if (profiler != nullptr) {
+        profiler->record(phase, start, profiler->now() - start);
+    }
+}
+
+Profiler::Profiler() : id(nextProfilerId++), epoch(std::chrono::steady_clock::now()) {
+    static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) == PHASE_COUNT, "every phase needs a name");
+    trace.reserve(TRACE_SIZE);
+}
+
+char const* Profiler::getPhaseName(Phase phase) {
+    return PHASE_NAMES[phase];
+}
+
+uint64_t Profiler::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+Profiler::ThreadBuffer* Profiler::getThreadBuffer() {
+    if (threadCache.profilerId == id) {
+        return static_cast<ThreadBuffer*>(threadCache.buffer);
+    }
+
+    threadCache.release();
+    std::shared_ptr<ThreadBuffer> buffer;
+    {
+        // Threads come and go with the job system and the simulation, so
+        // reuse the buffers of threads that have exited.
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (auto const& candidate : buffers) {
+            bool expected = false;
+            if (candidate->inUse.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                buffer = candidate;
+                break;
+            }
+        }
+        if (!buffer && buffers.size() < MAX_THREAD_BUFFERS) {
+            buffer = std::make_shared<ThreadBuffer>();
+            buffer->index = buffers.size();
+            buffers.push_back(buffer);
+        }
+    }
+
+    if (!buffer) {
+        // Uncached, so the thread looks again once a buffer frees up.
+        threadCache.profilerId = 0;
+        return nullptr;
+    }
+    threadCache.profilerId = id;
+    threadCache.buffer = buffer.get();
+    threadCache.inUse = std::shared_ptr<std::atomic<bool>>(buffer, &buffer->inUse);
+    return buffer.get();
+}
+
+void Profiler::record(Phase phase, uint64_t startNanos, uint64_t durationNanos) {
+    auto const buffer = getThreadBuffer();
+    if (buffer == nullptr) {
+        unbuffered.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    Sample const sample = {startNanos, (uint32_t)std::min<uint64_t>(durationNanos, UINT32_MAX), (uint8_t)phase, buffer->index};
+    if (!buffer->samples.push(sample)) {
+        buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Profiler::collect() {
+    uint64_t const collectTime = now();
+    if (lastCollect != 0) {
+        record(FRAME, lastCollect, collectTime - lastCollect);
+    }
+    lastCollect = collectTime;
+
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    Sample sample;
+    for (auto& buffer : buffers) {
+        while (buffer->samples.pop(sample)) {
+            histograms[sample.phase].add(sample.duration);
+            last[sample.phase] = sample.duration;
+            if (trace.size() < TRACE_SIZE) {
+                trace.push_back(sample);
+            } else {
+                trace[traceNext] = sample;
+            }
+            traceNext = (traceNext + 1) % TRACE_SIZE;
+        }
+    }
+}
+
+void Profiler::reset() {
+    for (auto& histogram : histograms) {
+        histogram.clear();
+    }
+    std::fill(last, last + PHASE_COUNT, 0);
+    trace.clear();
+    traceNext = 0;
+}
+
+Profiler::Summary Profiler::getSummary(Phase phase) const {
+    auto const& histogram = histograms[phase];
+    Summary summary;
+    summary.count = histogram.getCount();
+    summary.lastMicros = last[phase] / 1e3;
+    summary.p50Micros = histogram.getPercentile(0.50) / 1e3;
+    summary.p95Micros = histogram.getPercentile(0.95) / 1e3;
+    summary.p99Micros = histogram.getPercentile(0.99) / 1e3;
+    summary.maxMicros = histogram.getMax() / 1e3;
+    return summary;
+}
+
+uint64_t Profiler::getDroppedSamples() const {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    uint64_t dropped = unbuffered.load(std::memory_order_relaxed);
+    for (auto& buffer : buffers) {
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void Profiler::toggleOverlay() {
+    overlay = !overlay;
+}
+
+void Profiler::drawOverlay(float x, float y) const {
+    if (!overlay) {
+        return;
+    }
+
+    char line[128];
+    std::string text = "phase           last    p50    p95    p99    max (us)\n";
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        auto const summary = getSummary((Phase)phase);
+        snprintf(line, sizeof(line), "%-12s %7.0f %6.0f %6.0f %6.0f %6.0f\n", PHASE_NAMES[phase], summary.lastMicros, summary.p50Micros, summary.p95Micros, summary.p99Micros, summary.maxMicros);
+        text += line;
+    }
+    ofPushStyle();
+    ofDisableDepthTest();
+    ofDrawBitmapStringHighlight(text, x, y);
+    ofPopStyle();
+}
+
+bool Profiler::exportCsv(std::string const& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    file << "phase,count,p50Micros,p95Micros,p99Micros,maxMicros" << std::endl;
+    for (int phase = 0; phase < PHASE_COUNT; phase++) {
+        auto const summary = getSummary((Phase)phase);
+        file << PHASE_NAMES[phase] << "," << summary.count << "," << summary.p50Micros << "," << summary.p95Micros << "," << summary.p99Micros << "," << summary.maxMicros << std::endl;
+    }
+    return bool(file);
+}
+
+bool Profiler::exportChromeTrace(std::string const& path) const {
+    std::ofstream file(path);
+    if (!file) {
+        return false;
+    }
+
+    // Oldest first: once the trace has wrapped, traceNext is the oldest.
+    size_t const first = trace.size() < TRACE_SIZE ? 0 : traceNext;
+    file << "{\"traceEvents\":[";
+    for (size_t i = 0; i < trace.size(); i++) {
+        auto const& sample = trace[(first + i) % trace.size()];
+        file << (i > 0 ? ",\n" : "\n")
+            << "{\"name\":\"" << PHASE_NAMES[sample.phase] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << int(sample.thread)
+            << ",\"ts\":" << sample.start / 1e3 << ",\"dur\":" << sample.duration / 1e3 << "}";
+    }
+    file << "\n]}" << std::endl;
+    return bool(file);
+}
+
+void Profiler::Histogram::add(uint64_t nanos) {
+    buckets[getBucket(nanos)]++;
+    count++;
+    max = std::max(max, nanos);
+}
+
+void Profiler::Histogram::clear() {
+    std::fill(buckets, buckets + BUCKET_COUNT, 0);
+    count = 0;
+    max = 0;
+}
+
+uint64_t Profiler::Histogram::getCount() const {
+    return count;
+}
+
+uint64_t Profiler::Histogram::getMax() const {
+    return max;
+}
+
+uint64_t Profiler::Histogram::getPercentile(float fraction) const {
+    if (count == 0) {
+        return 0;
+    }
+
+    uint64_t const target = std::max<uint64_t>(1, std::ceil(fraction * count));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+        seen += buckets[bucket];
+        if (seen >= target) {
+            return std::min(getBucketTop(bucket), max);
+        }
+    }
+    return max;
+}
+
+int Profiler::Histogram::getBucket(uint64_t nanos) {
+    if (nanos < 2 * SUB_BUCKETS) {
+        return nanos;
+    }
+
+    int exponent = 63;
+    while (!(nanos >> exponent)) {
+        exponent--;
+    }
+    int const subBucket = (nanos >> (exponent - 3)) & (SUB_BUCKETS - 1);
+    return std::min(2 * SUB_BUCKETS + (exponent - 4) * SUB_BUCKETS + subBucket, BUCKET_COUNT - 1);
+}
+
+uint64_t Profiler::Histogram::getBucketTop(int bucket) {
+    if (bucket < 2 * SUB_BUCKETS) {
+        return bucket;
+    }
+
+    int const exponent = (bucket - 2 * SUB_BUCKETS) / SUB_BUCKETS + 4;
+    uint64_t const subBucket = (bucket - 2 * SUB_BUCKETS) % SUB_BUCKETS;
+    uint64_t const width = uint64_t(1) << (exponent - 3);
+    return (SUB_BUCKETS + subBucket) * width + width - 1;
+}
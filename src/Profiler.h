@@ -0,0 +1,142 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SpscRing.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+
+// Scoped phase timers. Any thread may record; each thread writes into its
+// own lock-free ring, and the main thread drains every ring once a frame
+// into per-phase histograms and a rolling trace for export.
+class Profiler {
+public:
+    enum Phase {
+        // Time between consecutive collect() calls.
+        FRAME,
+        CLEAN,
+        EASING,
+        SPAWN,
+        TRACER_UPDATE,
+        // One worker range of TRACER_UPDATE.
+        TRACER_JOB,
+        // Spatial hash build and neighbor queries, within TRACER_UPDATE.
+        INTERACTION,
+        DRAW,
+        BOX_DRAW,
+        VIDEO_OUTPUT,
+        // From a MIDI message arriving to the end of the frame that applied it.
+        MIDI_TO_FRAME,
+        // Age of the simulation tick a frame drew, from when it ran or was
+        // sent to a render node to the end of that frame's drawing.
+        TICK_TO_DRAW,
+        PHASE_COUNT
+    };
+
+    struct Summary {
+        uint64_t count = 0;
+        float lastMicros = 0;
+        float p50Micros = 0;
+        float p95Micros = 0;
+        float p99Micros = 0;
+        float maxMicros = 0;
+    };
+
+    // Times its own lifetime. A null profiler records nothing.
+    class Scope {
+    public:
+        Scope(Profiler* profiler, Phase phase);
+        ~Scope();
+
+    private:
+        Profiler* profiler;
+        Phase phase;
+        uint64_t start;
+    };
+
+    Profiler();
+
+    static char const* getPhaseName(Phase phase);
+
+    // Safe from any thread.
+    void record(Phase phase, uint64_t startNanos, uint64_t durationNanos);
+    uint64_t now() const;
+
+    // Main thread only, once a frame.
+    void collect();
+    void reset();
+    Summary getSummary(Phase phase) const;
+    uint64_t getDroppedSamples() const;
+
+    void toggleOverlay();
+    void drawOverlay(float x, float y) const;
+    // Phase percentiles, one row per phase.
+    bool exportCsv(std::string const& path) const;
+    // The most recent samples, for chrome://tracing or Perfetto.
+    bool exportChromeTrace(std::string const& path) const;
+
+private:
+    static size_t const THREAD_BUFFER_SIZE = 4096;
+    static size_t const TRACE_SIZE = 1 << 18;
+    // As many as Sample::thread can tell apart. Threads past this while
+    // every buffer is in use have their samples dropped.
+    static size_t const MAX_THREAD_BUFFERS = 256;
+
+    struct Sample {
+        uint64_t start;
+        uint32_t duration;
+        uint8_t phase;
+        uint8_t thread;
+    };
+
+    struct ThreadBuffer {
+        SpscRing<Sample> samples = {THREAD_BUFFER_SIZE};
+        std::atomic<uint64_t> dropped = {0};
+        uint8_t index = 0;
+        // Cleared when the recording thread exits, so a new thread can take
+        // the buffer over. Samples then keep the buffer's index as their thread.
+        std::atomic<bool> inUse = {true};
+    };
+
+    // Log-linear buckets: 8 per power of two, so percentiles land within
+    // about 12% of the true value at any scale.
+    class Histogram {
+    public:
+        static int const SUB_BUCKETS = 8;
+        static int const BUCKET_COUNT = 2 * SUB_BUCKETS + 40 * SUB_BUCKETS;
+
+        void add(uint64_t nanos);
+        void clear();
+        uint64_t getCount() const;
+        uint64_t getMax() const;
+        uint64_t getPercentile(float fraction) const;
+
+    private:
+        static int getBucket(uint64_t nanos);
+        static uint64_t getBucketTop(int bucket);
+
+        uint64_t buckets[BUCKET_COUNT] = {};
+        uint64_t count = 0;
+        uint64_t max = 0;
+    };
+
+    // Null once MAX_THREAD_BUFFERS threads hold one.
+    ThreadBuffer* getThreadBuffer();
+
+    uint64_t const id;
+    std::chrono::steady_clock::time_point const epoch;
+    mutable std::mutex buffersMutex;
+    // Shared with the threads' caches, which outlive the profiler if a
+    // thread exits after it.
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    // Samples from threads that found no free buffer.
+    std::atomic<uint64_t> unbuffered = {0};
+
+    Histogram histograms[PHASE_COUNT];
+    uint64_t last[PHASE_COUNT] = {};
+    std::vector<Sample> trace;
+    size_t traceNext = 0;
+    uint64_t lastCollect = 0;
+    bool overlay = false;
+};
@@ -0,0 +1,189 @@
+#include "PropertyGraph.h"
+
+PropertyGraph::Handle PropertyGraph::add(property_base* property) {
+    auto const existing = handles.find(property);
+    if (existing != handles.end()) {
+        return existing->second;
+    }
+
+    Handle const handle = properties.size();
+    properties.push_back(property);
+    handles[property] = handle;
+    readers.emplace_back();
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    queued.push_back(0);
+    return handle;
+}
+
+PropertyGraph::Handle PropertyGraph::getHandle(property_base* property) const {
+    auto const handle = handles.find(property);
+    return handle != handles.end() ? handle->second : INVALID_HANDLE;
+}
+
+PropertyGraph::Handle PropertyGraph::getHandle(std::string const& name) const {
+    for (size_t i = 0; i < properties.size(); i++) {
+        if (properties[i]->getName() == name) {
+            return i;
+        }
+    }
+    return INVALID_HANDLE;
+}
+
+property_base* PropertyGraph::get(Handle handle) const {
+    return properties[handle];
+}
+
+size_t PropertyGraph::size() const {
+    return properties.size();
+}
+
+void PropertyGraph::addRule(std::vector<Handle> const& inputs, std::vector<Handle> const& outputs, Rule const& rule) {
+    RuleNode node;
+    node.inputs = inputs;
+    node.outputs = outputs;
+    node.rule = rule;
+    for (auto input : inputs) {
+        readers[input].push_back(rules.size());
+    }
+    rules.push_back(node);
+    scheduled.push_back(0);
+    sorted = false;
+}
+
+void PropertyGraph::markDirty(Handle handle) {
+    if (handle == INVALID_HANDLE) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    if (!queued[handle]) {
+        queued[handle] = 1;
+        pending.push_back(handle);
+    }
+}
+
+void PropertyGraph::markDirty(property_base* property) {
+    markDirty(getHandle(property));
+}
+
+void PropertyGraph::markDirty(Handle const* handles, size_t count) {
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    for (size_t i = 0; i < count; i++) {
+        Handle const handle = handles[i];
+        if (handle != INVALID_HANDLE && !queued[handle]) {
+            queued[handle] = 1;
+            pending.push_back(handle);
+        }
+    }
+}
+
+void PropertyGraph::sortRules() {
+    // Kahn's algorithm over rules: a rule waits for every rule writing one
+    // of its inputs.
+    std::vector<std::vector<int>> writers(properties.size());
+    for (size_t r = 0; r < rules.size(); r++) {
+        for (auto output : rules[r].outputs) {
+            writers[output].push_back(r);
+        }
+    }
+    std::vector<int> waiting(rules.size(), 0);
+    std::vector<std::vector<int>> next(rules.size());
+    for (size_t r = 0; r < rules.size(); r++) {
+        for (auto input : rules[r].inputs) {
+            for (auto writer : writers[input]) {
+                if (writer != (int)r) {
+                    next[writer].push_back(r);
+                    waiting[r]++;
+                }
+            }
+        }
+    }
+
+    order.clear();
+    for (size_t r = 0; r < rules.size(); r++) {
+        if (waiting[r] == 0) {
+            order.push_back(r);
+        }
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        for (auto r : next[order[i]]) {
+            if (--waiting[r] == 0) {
+                order.push_back(r);
+            }
+        }
+    }
+    if (order.size() < rules.size()) {
+        ofLogWarning("PropertyGraph") << rules.size() - order.size() << " rules form a cycle; running them in the order they were added";
+        for (size_t r = 0; r < rules.size(); r++) {
+            if (waiting[r] > 0) {
+                order.push_back(r);
+            }
+        }
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        rules[order[i]].rank = i;
+    }
+    sorted = true;
+}
+
+void PropertyGraph::clean(Handle handle) {
+    properties[handle]->clean();
+    cleaned.push_back(handle);
+    cleanCount++;
+    for (auto r : readers[handle]) {
+        // Only a cycle could lead back to a rule that already ran.
+        if (!scheduled[r] && rules[r].rank > runningRank) {
+            scheduled[r] = 1;
+            ready.push_back(rules[r].rank);
+            std::push_heap(ready.begin(), ready.end(), std::greater<int>());
+        }
+    }
+}
+
+void PropertyGraph::update() {
+    if (!sorted) {
+        sortRules();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        dirty.swap(pending);
+        for (auto handle : dirty) {
+            queued[handle] = 0;
+        }
+    }
+
+    runningRank = -1;
+    cleaned.clear();
+    for (auto handle : dirty) {
+        clean(handle);
+    }
+    dirty.clear();
+
+    // Outputs are cleaned as each rule finishes, which can only schedule
+    // rules of a higher rank, so popping by rank runs every rule once.
+    while (!ready.empty()) {
+        std::pop_heap(ready.begin(), ready.end(), std::greater<int>());
+        runningRank = ready.back();
+        int const r = order[runningRank];
+        ready.pop_back();
+        scheduled[r] = 0;
+        rules[r].rule();
+        ruleRunCount++;
+        for (auto output : rules[r].outputs) {
+            clean(output);
+        }
+    }
+}
+
+std::vector<PropertyGraph::Handle> const& PropertyGraph::getCleaned() const {
+    return cleaned;
+}
+
+uint64_t PropertyGraph::getCleanCount() const {
+    return cleanCount;
+}
+
+uint64_t PropertyGraph::getRuleRunCount() const {
+    return ruleRunCount;
+}
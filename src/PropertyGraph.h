@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ofxBenG.h"
+#include <mutex>
+
+// Change propagation between properties. Every property gets an integer
+// handle; writers mark the handles they touch, and once a frame update()
+// cleans only those properties and runs only the rules that read them, each
+// rule at most once and after every rule that feeds it. Per-frame cost grows
+// with what changed, not with how many properties exist.
+class PropertyGraph {
+public:
+    typedef int Handle;
+    typedef std::function<void()> Rule;
+    static Handle const INVALID_HANDLE = -1;
+
+    Handle add(property_base* property);
+    // Setup-time lookups; per-frame code should keep the handle.
+    Handle getHandle(property_base* property) const;
+    Handle getHandle(std::string const& name) const;
+    property_base* get(Handle handle) const;
+    size_t size() const;
+
+    // rule runs in any frame where one of inputs changed, before the rules
+    // that read any of its outputs.
+    void addRule(std::vector<Handle> const& inputs, std::vector<Handle> const& outputs, Rule const& rule);
+
+    // Safe from any thread; marks are coalesced until the next update().
+    void markDirty(Handle handle);
+    void markDirty(property_base* property);
+    void markDirty(Handle const* handles, size_t count);
+
+    // Main thread, once a frame.
+    void update();
+    // Handles update() cleaned last time, in the order it cleaned them.
+    std::vector<Handle> const& getCleaned() const;
+    uint64_t getCleanCount() const;
+    uint64_t getRuleRunCount() const;
+
+private:
+    struct RuleNode {
+        std::vector<Handle> inputs;
+        std::vector<Handle> outputs;
+        Rule rule;
+        int rank = 0;
+    };
+
+    void sortRules();
+    void clean(Handle handle);
+
+    std::vector<property_base*> properties;
+    std::map<property_base*, Handle> handles;
+    std::vector<RuleNode> rules;
+    // Rule indices reading each property, and rule indices by rank.
+    std::vector<std::vector<int>> readers;
+    std::vector<int> order;
+    bool sorted = true;
+
+    std::mutex pendingMutex;
+    std::vector<Handle> pending;
+    std::vector<char> queued;
+
+    std::vector<Handle> dirty;
+    std::vector<char> scheduled;
+    std::vector<int> ready;
+    std::vector<Handle> cleaned;
+    int runningRank = -1;
+    uint64_t cleanCount = 0;
+    uint64_t ruleRunCount = 0;
+};
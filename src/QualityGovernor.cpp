@@ -0,0 +1,107 @@
+#include "QualityGovernor.h"
+#include <climits>
+#include <cstdio>
+
+namespace {
+
+// Full quality first; each level gives up more. Curve resolution goes first
+// since it is hardest to see, then multiplier copies, then the far half of
+// each trail.
+QualityGovernor::Decisions const LADDER[] = {
+    {INT_MAX, INT_MAX, 1},
+    {4, INT_MAX, 1},
+    {4, 64, 1},
+    {2, 64, 1},
+    {2, 16, 1},
+    {2, 16, 0.5},
+    {1, 4, 0.5},
+    {1, 4, 0.25},
+    {1, 1, 0.25},
+    {1, 0, 0.1}
+};
+int const LEVEL_COUNT = sizeof(LADDER) / sizeof(LADDER[0]);
+
+}
+
+void QualityGovernor::setEnabled(bool enabled) {
+    this->enabled = enabled;
+    if (!enabled) {
+        level = 0;
+        over = 0;
+        under = 0;
+        settle = 0;
+    }
+}
+
+bool QualityGovernor::isEnabled() const {
+    return enabled;
+}
+
+void QualityGovernor::setBudget(float millis) {
+    budget = millis;
+}
+
+bool QualityGovernor::update(float frameMillis) {
+    average += (frameMillis - average) * SMOOTHING;
+    if (!enabled) {
+        return false;
+    }
+    if (settle > 0) {
+        settle--;
+        return false;
+    }
+
+    if (average > budget) {
+        over++;
+        under = 0;
+    } else if (average < budget * RESTORE_RATIO) {
+        under++;
+        over = 0;
+    } else {
+        over = 0;
+        under = 0;
+    }
+
+    int const previous = level;
+    if (over >= DEGRADE_FRAMES && level < LEVEL_COUNT - 1) {
+        level++;
+    } else if (under >= RESTORE_FRAMES && level > 0) {
+        level--;
+    }
+    if (level == previous) {
+        return false;
+    }
+    over = 0;
+    under = 0;
+    settle = SETTLE_FRAMES;
+    return true;
+}
+
+int QualityGovernor::getLevel() const {
+    return level;
+}
+
+int QualityGovernor::getLevelCount() const {
+    return LEVEL_COUNT;
+}
+
+float QualityGovernor::getAverageMillis() const {
+    return average;
+}
+
+QualityGovernor::Decisions QualityGovernor::getDecisions() const {
+    return LADDER[level];
+}
+
+std::string QualityGovernor::describe() const {
+    if (level == 0) {
+        return "full quality";
+    }
+    auto const decisions = getDecisions();
+    char text[128];
+    snprintf(text, sizeof(text), "quality %d/%d: curve resolution %d, multiplier copies %s, far trails %d%%",
+        level, LEVEL_COUNT - 1, decisions.curveResolution,
+        decisions.maxMultiplierCount == INT_MAX ? "all" : std::to_string(decisions.maxMultiplierCount).c_str(),
+        int(decisions.farTrailFraction * 100));
+    return text;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+
+// Holds frame cost under a budget by trading away detail. Each frame it
+// takes the CPU time from the start of update() to the end of drawing and
+// keeps a smoothed average. While the average is over budget it steps down
+// a fixed ladder of cheaper settings; once the average has stayed well
+// under budget for a while it steps back up. Each step waits for the
+// average to settle before the next one, so it does not oscillate.
+class QualityGovernor {
+public:
+    // What the current level allows; level 0 allows everything.
+    struct Decisions {
+        int curveResolution;
+        int maxMultiplierCount;
+        // Share of maxPoints kept by tracers on the far side of the box.
+        float farTrailFraction;
+    };
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+    void setBudget(float millis);
+    // Returns true when the decisions changed.
+    bool update(float frameMillis);
+
+    int getLevel() const;
+    int getLevelCount() const;
+    float getAverageMillis() const;
+    Decisions getDecisions() const;
+    std::string describe() const;
+
+private:
+    float const SMOOTHING = 0.1;
+    // Restore only when the average is below this share of the budget.
+    float const RESTORE_RATIO = 0.6;
+    int const DEGRADE_FRAMES = 10;
+    int const RESTORE_FRAMES = 120;
+    int const SETTLE_FRAMES = 30;
+
+    bool enabled = false;
+    float budget = 14;
+    float average = 0;
+    int level = 0;
+    int over = 0;
+    int under = 0;
+    int settle = 0;
+};
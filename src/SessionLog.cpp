@@ -0,0 +1,150 @@
+#include "SessionLog.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+char const* const TYPE_NAMES[] = {
+    "frame", "propertySnapshot", "property", "midiEncoder", "midiPushSwitch", "midiSideButton", "key", "audioVolume", "audioTempo", "audioTempoConfidence"
+};
+
+}
+
+static_assert(sizeof(SessionLog::Record) == 24, "records are written as they are laid out");
+static_assert(sizeof(TYPE_NAMES) / sizeof(TYPE_NAMES[0]) == SessionLog::TYPE_COUNT, "every record type needs a name");
+
+SessionLog::SessionLog() {
+}
+
+SessionLog::~SessionLog() {
+    stop();
+}
+
+char const* SessionLog::getTypeName(Type type) {
+    return type < TYPE_COUNT ? TYPE_NAMES[type] : "unknown";
+}
+
+bool SessionLog::start(std::string const& path, std::vector<std::string> const& propertyNames) {
+    stop();
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        return false;
+    }
+
+    Header header;
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.propertyCount = propertyNames.size();
+    header.recordBytes = sizeof(Record);
+    fwrite(&header, sizeof(Header), 1, file);
+    for (auto const& name : propertyNames) {
+        char bytes[NAME_BYTES] = {};
+        strncpy(bytes, name.c_str(), NAME_BYTES - 1);
+        fwrite(bytes, NAME_BYTES, 1, file);
+    }
+    dropped = 0;
+    writing = true;
+    writer = std::thread(&SessionLog::write, this);
+    return true;
+}
+
+void SessionLog::stop() {
+    if (file == nullptr) {
+        return;
+    }
+    writing = false;
+    writer.join();
+    fclose(file);
+    file = nullptr;
+}
+
+bool SessionLog::isRecording() const {
+    return file != nullptr;
+}
+
+void SessionLog::beginFrame(uint64_t micros, uint32_t frame, float previousFrameMillis) {
+    this->micros = micros;
+    this->frame = frame;
+    append(FRAME, 0, previousFrameMillis);
+}
+
+void SessionLog::append(Type type, int id, float value) {
+    if (file == nullptr) {
+        return;
+    }
+
+    Record record;
+    record.micros = micros;
+    record.frame = frame;
+    record.type = type;
+    record.id = id;
+    record.value = value;
+    record.reserved = 0;
+    if (!ring.push(record)) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint64_t SessionLog::getDropped() const {
+    return dropped.load(std::memory_order_relaxed);
+}
+
+void SessionLog::write() {
+    std::vector<Record> records(RING_SIZE);
+    while (true) {
+        // Read the flag first so the last pass drains everything appended before stop().
+        bool const stopping = !writing;
+        size_t count;
+        while ((count = ring.pop(records.data(), records.size())) > 0) {
+            fwrite(records.data(), sizeof(Record), count, file);
+        }
+        fflush(file);
+        if (stopping) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(WRITE_INTERVAL_MILLIS));
+    }
+}
+
+bool SessionLog::load(std::string const& path, std::vector<std::string>& propertyNames, std::vector<Record>& records) {
+    std::ifstream in(path, std::ios::binary);
+    Header header;
+    if (!in.read((char*)&header, sizeof(Header)) || header.magic != MAGIC || header.version != VERSION || header.recordBytes != sizeof(Record)) {
+        return false;
+    }
+
+    propertyNames.clear();
+    for (uint32_t i = 0; i < header.propertyCount; i++) {
+        char bytes[NAME_BYTES];
+        if (!in.read(bytes, NAME_BYTES)) {
+            return false;
+        }
+        propertyNames.push_back(std::string(bytes, strnlen(bytes, NAME_BYTES)));
+    }
+
+    records.clear();
+    Record record;
+    while (in.read((char*)&record, sizeof(Record))) {
+        records.push_back(record);
+    }
+    return true;
+}
+
+int SessionLog::dump(std::string const& path) {
+    std::vector<std::string> names;
+    std::vector<Record> records;
+    if (!load(path, names, records)) {
+        std::cerr << "Could not read " << path << std::endl;
+        return 1;
+    }
+
+    std::cout << "micros,frame,type,id,name,value" << std::endl;
+    for (auto const& record : records) {
+        bool const named = (record.type == PROPERTY_SNAPSHOT || record.type == PROPERTY) && record.id < names.size();
+        std::cout << record.micros << "," << record.frame << "," << getTypeName((Type)record.type) << "," << record.id
+            << "," << (named ? names[record.id] : "") << "," << record.value << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "SpscRing.h"
+#include <atomic>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+// An append-only binary log of everything that drives a show: controller
+// events, performance key presses, audio levels and the properties they
+// change, each stamped with the app clock and frame number. The main
+// thread only copies fixed-size records into a ring; a background thread
+// writes them out, so logging never waits on the disk. A log starts with
+// a snapshot of every performance property, which is what lets a replay
+// start from the same scene.
+//
+// File layout: Header, propertyCount names of NAME_BYTES each (property
+// handle order), then Records until the end of the file.
+class SessionLog {
+public:
+    enum Type : uint16_t {
+        // One per frame; value is the previous frame's CPU milliseconds.
+        FRAME,
+        // A property's scale when the log started; id is its handle.
+        PROPERTY_SNAPSHOT,
+        // A property's scale after it changed; id is its handle.
+        PROPERTY,
+        // MidiQueue events, in MidiQueue::Control order; id is the control id.
+        MIDI_ENCODER,
+        MIDI_PUSH_SWITCH,
+        MIDI_SIDE_BUTTON,
+        // id is the key.
+        KEY,
+        AUDIO_VOLUME,
+        AUDIO_TEMPO,
+        AUDIO_TEMPO_CONFIDENCE,
+        TYPE_COUNT
+    };
+
+    struct Record {
+        uint64_t micros;
+        uint32_t frame;
+        uint16_t type;
+        uint16_t id;
+        float value;
+        uint32_t reserved;
+    };
+
+    SessionLog();
+    ~SessionLog();
+
+    bool start(std::string const& path, std::vector<std::string> const& propertyNames);
+    // Writes everything appended so far, then closes the file.
+    void stop();
+    bool isRecording() const;
+    // Main thread. Records the FRAME record and stamps later records with this frame.
+    void beginFrame(uint64_t micros, uint32_t frame, float previousFrameMillis);
+    void append(Type type, int id, float value);
+    // Records lost because the writer fell a whole ring behind.
+    uint64_t getDropped() const;
+
+    // Reads a whole log; a record cut short at the end is ignored.
+    static bool load(std::string const& path, std::vector<std::string>& propertyNames, std::vector<Record>& records);
+    // Prints a log as CSV.
+    static int dump(std::string const& path);
+    static char const* getTypeName(Type type);
+
+private:
+    static uint32_t const MAGIC = 0x4c535254; // "TRSL"
+    static uint32_t const VERSION = 1;
+    static int const NAME_BYTES = 32;
+    static size_t const RING_SIZE = 1 << 16;
+    int const WRITE_INTERVAL_MILLIS = 20;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t propertyCount;
+        uint32_t recordBytes;
+    };
+
+    void write();
+
+    SpscRing<Record> ring = {RING_SIZE};
+    FILE* file = nullptr;
+    std::thread writer;
+    std::atomic<bool> writing = {false};
+    std::atomic<uint64_t> dropped = {0};
+    uint64_t micros = 0;
+    uint32_t frame = 0;
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Layout of the shared-memory video output, shared with readers outside
+// the app. The segment is this header followed by SLOT_COUNT frame slots,
+// each slotBytes long starting at slotOffset.
+//
+// The writer never waits for readers. It fills the slot that is neither
+// the latest nor the one before it, so a reader holding the latest frame
+// has two frames to finish with it. Each slot's sequence is odd while the
+// slot is being written; a reader that sees the same even sequence before
+// and after using a slot knows the frame was not overwritten underneath it.
+namespace SharedFrame {
+    uint32_t const MAGIC = 0x52435254; // "TRCR"
+    uint32_t const VERSION = 1;
+    int const SLOT_COUNT = 3;
+    // RGBA, 8 bits a channel, bottom row first as OpenGL reads it.
+    uint32_t const FORMAT_RGBA_BOTTOM_UP = 0;
+
+    struct Slot {
+        std::atomic<uint64_t> sequence;
+        // Frame number, counting from 1.
+        uint64_t frame;
+        // steady_clock nanoseconds when the frame finished rendering.
+        uint64_t renderedNanos;
+        uint64_t publishedNanos;
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t stride;
+        uint32_t format;
+        uint64_t slotBytes;
+        uint64_t slotOffset;
+        // Set when the writer replaces the segment, e.g. on resize; reopen by name.
+        std::atomic<uint32_t> closed;
+        // Index of the latest complete slot, or -1 before the first frame.
+        std::atomic<int32_t> latest;
+        Slot slots[SLOT_COUNT];
+    };
+}
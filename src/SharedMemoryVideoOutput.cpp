@@ -0,0 +1,105 @@
+#include "SharedMemoryVideoOutput.h"
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+SharedMemoryVideoOutput::SharedMemoryVideoOutput(std::string const& name) : name("/" + name) {
+}
+
+SharedMemoryVideoOutput::~SharedMemoryVideoOutput() {
+    readback.release();
+    close();
+}
+
+bool SharedMemoryVideoOutput::open(int width, int height) {
+    close();
+    shm_unlink(name.c_str());
+    int const fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        ofLogError("SharedMemoryVideoOutput") << "shm_open " << name << ": " << strerror(errno);
+        return false;
+    }
+
+    // Slots start on page boundaries so readers can hand them to the GPU.
+    size_t const page = sysconf(_SC_PAGESIZE);
+    size_t const slotOffset = (sizeof(SharedFrame::Header) + page - 1) / page * page;
+    size_t const slotBytes = ((size_t)width * height * 4 + page - 1) / page * page;
+    size = slotOffset + SharedFrame::SLOT_COUNT * slotBytes;
+    void* memory = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        ofLogError("SharedMemoryVideoOutput") << "mapping " << size << " bytes of " << name << ": " << strerror(errno);
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    header = new (memory) SharedFrame::Header();
+    header->version = SharedFrame::VERSION;
+    header->width = width;
+    header->height = height;
+    header->stride = width * 4;
+    header->format = SharedFrame::FORMAT_RGBA_BOTTOM_UP;
+    header->slotBytes = slotBytes;
+    header->slotOffset = slotOffset;
+    header->closed = 0;
+    header->latest = -1;
+    for (auto& slot : header->slots) {
+        slot.sequence = 0;
+    }
+    // Readers check the magic last, so everything above is visible first.
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = SharedFrame::MAGIC;
+    ofLogNotice("SharedMemoryVideoOutput") << "Publishing " << width << "x" << height << " frames at " << name;
+    return true;
+}
+
+void SharedMemoryVideoOutput::close() {
+    if (header == nullptr) {
+        return;
+    }
+    header->closed.store(1, std::memory_order_release);
+    munmap(header, size);
+    shm_unlink(name.c_str());
+    header = nullptr;
+}
+
+void SharedMemoryVideoOutput::publishScreen(int width, int height) {
+    if (failed) {
+        return;
+    }
+
+    auto const pixels = readback.read(width, height, GL_RGBA);
+    if (pixels.data == nullptr) {
+        return;
+    }
+    if (header == nullptr || header->width != (uint32_t)pixels.width || header->height != (uint32_t)pixels.height) {
+        if (!open(pixels.width, pixels.height)) {
+            failed = true;
+            readback.release();
+            return;
+        }
+    }
+
+    // Skip the latest slot and the one before it, which readers may still hold.
+    int const latest = header->latest.load(std::memory_order_relaxed);
+    int const index = latest < 0 ? 0 : (latest + 1) % SharedFrame::SLOT_COUNT;
+    auto& slot = header->slots[index];
+    uint64_t const sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    memcpy((char*)header + header->slotOffset + index * header->slotBytes, pixels.data, header->stride * header->height);
+    readback.release();
+    slot.frame = ++frame;
+    slot.renderedNanos = pixels.readNanos;
+    slot.publishedNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    header->latest.store(index, std::memory_order_release);
+}
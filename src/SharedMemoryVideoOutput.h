@@ -0,0 +1,26 @@
+#pragma once
+
+#include "VideoOutput.h"
+#include "PixelReadback.h"
+#include "SharedFrame.h"
+
+// Publishes frames into a POSIX shared-memory triple buffer described by
+// SharedFrame.h, at /dev/shm/<name> on Linux. Readers map the segment and
+// use frames in place; the renderer never waits for them.
+class SharedMemoryVideoOutput : public VideoOutput {
+public:
+    SharedMemoryVideoOutput(std::string const& name);
+    ~SharedMemoryVideoOutput();
+    void publishScreen(int width, int height) override;
+
+private:
+    bool open(int width, int height);
+    void close();
+
+    std::string const name;
+    PixelReadback readback;
+    SharedFrame::Header* header = nullptr;
+    size_t size = 0;
+    uint64_t frame = 0;
+    bool failed = false;
+};
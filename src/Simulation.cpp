@@ -0,0 +1,258 @@
+#include "Simulation.h"
+
+Simulation::Simulation(int maxPointsCapacity, int maxTracers) : tracers(maxPointsCapacity) {
+    tracers.reserve(maxTracers);
+    sparkPoints.setMode(OF_PRIMITIVE_POINTS);
+}
+
+Simulation::~Simulation() {
+    stop();
+}
+
+void Simulation::setProfiler(Profiler* profiler) {
+    this->profiler = profiler;
+    tracers.setProfiler(profiler);
+}
+
+void Simulation::setInput(Input const& input) {
+    std::lock_guard<std::mutex> lock(inputMutex);
+    this->input = input;
+}
+
+void Simulation::setPipeline(TracerPool::Pipeline const& pipeline) {
+    std::lock_guard<std::mutex> lock(inputMutex);
+    this->pipeline = pipeline;
+    pipelineChanged = true;
+}
+
+void Simulation::setSender(StreamSender* sender) {
+    this->sender = sender;
+}
+
+void Simulation::start(float ticksPerSecond, float startMillis) {
+    stop();
+    stopping = false;
+    thread = std::thread(&Simulation::run, this, ticksPerSecond, startMillis);
+}
+
+void Simulation::stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(runMutex);
+        stopping = true;
+    }
+    stopRequested.notify_all();
+    thread.join();
+}
+
+bool Simulation::isThreaded() const {
+    return thread.joinable();
+}
+
+void Simulation::step() {
+    float millis;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        millis = input.frame.time;
+    }
+    tick(millis);
+}
+
+void Simulation::run(float ticksPerSecond, float startMillis) {
+    auto const step = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(1.0 / ticksPerSecond));
+    auto const start = std::chrono::steady_clock::now();
+    auto next = start;
+    std::unique_lock<std::mutex> lock(runMutex);
+    while (!stopping) {
+        lock.unlock();
+        tick(startMillis + std::chrono::duration<float, std::milli>(next - start).count());
+        lock.lock();
+
+        next += step;
+        auto const now = std::chrono::steady_clock::now();
+        if (now - next > step * MAX_CATCH_UP_TICKS) {
+            // Skip the missed ticks rather than run them back to back.
+            next += (now - next) / step * step;
+        }
+        stopRequested.wait_until(lock, next, [&]() { return stopping; });
+    }
+}
+
+void Simulation::tick(float millis) {
+    uint64_t const start = profiler ? profiler->now() : 0;
+    Input current;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        current = input;
+        if (pipelineChanged) {
+            tracers.setPipeline(pipeline);
+            pipelineChanged = false;
+        }
+    }
+
+    applyInput(current);
+    spawnTracers(current);
+
+    {
+        Profiler::Scope scope(profiler, Profiler::TRACER_UPDATE);
+        current.frame.time = millis;
+        tracers.update(current.frame, jobs);
+    }
+    StreamSender* const sender = this->sender;
+    if (sender != nullptr) {
+        sender->send(ticks + 1, millis, tracers.getHeads(), tracers.size());
+    }
+
+    publish(current, millis, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    if (profiler) {
+        tickMillis = (profiler->now() - start) / 1e6;
+    }
+}
+
+void Simulation::follow(TracerPool::Frame const& frame, ofVec3f const* heads, size_t count) {
+    Input current;
+    {
+        std::lock_guard<std::mutex> lock(inputMutex);
+        current = input;
+    }
+    applyInput(current);
+    Profiler::Scope scope(profiler, Profiler::TRACER_UPDATE);
+    tracers.updateFromHeads(frame, heads, count, jobs);
+}
+
+void Simulation::publish(Input const& input, float millis, uint64_t producedNanos) {
+    auto& snapshot = snapshots.getBack();
+    snapshot.backend = input.strokeBackend;
+    if (snapshot.backend == StrokeMesh::MESH) {
+        tracers.buildStrokes(input.style, snapshot.strokes);
+    } else {
+        tracers.buildPaths(input.style, snapshot.paths, snapshot.offsets);
+    }
+    snapshot.sparks = tracers.getSparks();
+    snapshot.tick = ++ticks;
+    snapshot.millis = millis;
+    snapshot.producedNanos = producedNanos;
+    snapshots.publish();
+}
+
+void Simulation::applyInput(Input const& input) {
+    if (input.velocity != velocity) {
+        velocity = input.velocity;
+        tracers.setVelocity(velocity);
+    }
+    if (input.threadCount != threadCount) {
+        threadCount = input.threadCount;
+        jobs.setThreadCount(threadCount);
+    }
+    if (input.strokeGeneration != strokeGeneration) {
+        strokeGeneration = input.strokeGeneration;
+        tracers.invalidateStrokes();
+    }
+}
+
+void Simulation::spawnTracers(Input const& input) {
+    Profiler::Scope scope(profiler, Profiler::SPAWN);
+    auto const stageSize = input.stageSize;
+    while (tracers.size() < (size_t)input.tracerCount) {
+        ofVec3f timeShift(ofRandom(stageSize[0]), ofRandom(stageSize[1]), ofRandom(stageSize[2]));
+        ofVec3f head(ofRandom(stageSize[0]), ofRandom(stageSize[1]), ofRandom(-stageSize[2], stageSize[2]));
+        tracers.spawn(head, timeShift, velocity);
+    }
+    while (tracers.size() > (size_t)std::max(input.tracerCount, 0)) {
+        tracers.despawn();
+    }
+}
+
+void Simulation::draw(TracerPool::Style const& style) {
+    auto const& snapshot = snapshots.acquire();
+    drawnNanos = snapshot.producedNanos;
+    if (snapshot.backend == StrokeMesh::MESH) {
+        drawMesh(snapshot, style);
+    } else {
+        drawPaths(snapshot, style);
+    }
+    drawSparks(snapshot, style);
+}
+
+void Simulation::drawMesh(Snapshot const& snapshot, TracerPool::Style const& style) {
+    // One VBO and one instanced draw per tracer: each tracer's copies are
+    // shifted by offsets of their own, which one draw could not tell apart.
+    if (snapshot.tick != uploadedTick) {
+        // Reuploads only when the simulation has ticked since the last frame.
+        if (strokes.size() < snapshot.strokes.size()) {
+            strokes.resize(snapshot.strokes.size());
+        }
+        for (size_t i = 0; i < strokes.size(); i++) {
+            auto& uploaded = strokes[i];
+            uploaded.indices = 0;
+            if (i < snapshot.strokes.size() && !snapshot.strokes[i].mesh.getIndices().empty()) {
+                StrokeMesh::upload(snapshot.strokes[i], uploaded.vbo);
+                uploaded.indices = snapshot.strokes[i].mesh.getIndices().size();
+                uploaded.copies = snapshot.strokes[i].offsets.size();
+            }
+        }
+        uploadedTick = snapshot.tick;
+    }
+
+    ofPushStyle();
+    if (ofGetStyle().blendingMode == OF_BLENDMODE_DISABLED) {
+        // The stroke edges are feathered through alpha.
+        ofEnableAlphaBlending();
+    }
+    ofSetColor(style.strokeColor);
+    StrokeMesh::begin(style.strokeWidth, style.viewNormal);
+    for (auto const& uploaded : strokes) {
+        if (uploaded.indices > 0) {
+            StrokeMesh::drawInstanced(uploaded.vbo, uploaded.indices, uploaded.copies);
+        }
+    }
+    StrokeMesh::end();
+    ofPopStyle();
+}
+
+void Simulation::drawPaths(Snapshot const& snapshot, TracerPool::Style const& style) {
+    auto const& paths = snapshot.paths;
+    size_t const copies = paths.empty() ? 0 : snapshot.offsets.size() / paths.size();
+    ofPushStyle();
+    ofSetColor(style.strokeColor);
+    ofSetLineWidth(style.strokeWidth);
+    for (size_t i = 0; i < paths.size(); i++) {
+        paths[i].draw();
+        for (size_t copy = 0; copy < copies; copy++) {
+            ofPushMatrix();
+            ofTranslate(snapshot.offsets[i * copies + copy]);
+            paths[i].draw();
+            ofPopMatrix();
+        }
+    }
+    ofPopStyle();
+}
+
+void Simulation::drawSparks(Snapshot const& snapshot, TracerPool::Style const& style) {
+    if (snapshot.sparks.empty()) {
+        return;
+    }
+
+    sparkPoints.getVertices() = snapshot.sparks;
+    ofPushStyle();
+    ofSetColor(255);
+    glPointSize(style.strokeWidth * 2);
+    sparkPoints.draw();
+    glPointSize(1);
+    ofPopStyle();
+}
+
+uint64_t Simulation::getTicks() const {
+    return ticks;
+}
+
+float Simulation::getTickMillis() const {
+    return tickMillis;
+}
+
+uint64_t Simulation::getDrawnNanos() const {
+    return drawnNanos;
+}
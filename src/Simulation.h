@@ -0,0 +1,130 @@
+#pragma once
+
+#include "ofMain.h"
+#include "JobSystem.h"
+#include "Profiler.h"
+#include "StreamSender.h"
+#include "TracerPool.h"
+#include "TripleBuffer.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Runs the tracers, either on the main thread through step() or on its
+// own thread at a fixed tick rate. Each tick updates every tracer and
+// builds the stroke mesh into a snapshot that is published through a
+// triple buffer; draw() uploads the newest snapshot, so the GL thread and
+// the simulation only ever wait on themselves. Everything the tracers read
+// from the app arrives through setInput(), and only the simulation touches
+// the pool, so tracer state needs no locks.
+//
+// On a render node the tracers follow heads streamed from the node that
+// runs the simulation instead: follow() each tick as it arrives, then
+// publish() once per frame.
+class Simulation {
+public:
+    // The app state one tick reads.
+    struct Input {
+        // frame.time is only used when stepping on the main thread; the
+        // simulation thread keeps its own steady time.
+        TracerPool::Frame frame;
+        TracerPool::Style style;
+        int tracerCount = 0;
+        ofVec3f stageSize;
+        ofVec3f velocity;
+        int threadCount = 1;
+        // Bump to make every stroke tessellate again.
+        uint64_t strokeGeneration = 0;
+        StrokeMesh::Backend strokeBackend = StrokeMesh::MESH;
+    };
+
+    // Immutable once published.
+    struct Snapshot {
+        StrokeMesh::Backend backend = StrokeMesh::MESH;
+        // Filled for the MESH backend, one per tracer.
+        std::vector<StrokeMesh::Instanced> strokes;
+        // Filled for the path backends; see TracerPool::buildPaths().
+        std::vector<ofPolyline> paths;
+        std::vector<ofVec3f> offsets;
+        // See TracerPool::getSparks().
+        std::vector<ofVec3f> sparks;
+        uint64_t tick = 0;
+        float millis = 0;
+        // steady_clock nanoseconds when the tick ran, or was sent to this node.
+        uint64_t producedNanos = 0;
+    };
+
+    Simulation(int maxPointsCapacity, int maxTracers);
+    ~Simulation();
+
+    void setProfiler(Profiler* profiler);
+    void setInput(Input const& input);
+    // The update passes each tick runs; see TracerPool::setPipeline().
+    void setPipeline(TracerPool::Pipeline const& pipeline);
+    // Sends every tick on to render nodes; null stops sending.
+    void setSender(StreamSender* sender);
+
+    // Ticks on a thread of its own until stop(); starting again changes the rate.
+    void start(float ticksPerSecond, float startMillis);
+    void stop();
+    bool isThreaded() const;
+    // One tick on the calling thread, with the input's frame time.
+    void step();
+    // Render nodes, on the main thread while not threaded.
+    void follow(TracerPool::Frame const& frame, ofVec3f const* heads, size_t count);
+    void publish(Input const& input, float millis, uint64_t producedNanos);
+
+    // Main thread: draws the newest snapshot. The path backends stroke
+    // through the current renderer, so the app has to install the matching one.
+    void draw(TracerPool::Style const& style);
+    uint64_t getTicks() const;
+    // Cost of the latest tick, which the frame budget has to cover too.
+    float getTickMillis() const;
+    // When the snapshot the last draw() drew was produced, or 0 before any.
+    uint64_t getDrawnNanos() const;
+
+private:
+    // A tick that falls this many ticks behind skips ahead instead of catching up.
+    int const MAX_CATCH_UP_TICKS = 4;
+
+    void run(float ticksPerSecond, float startMillis);
+    void tick(float millis);
+    void applyInput(Input const& input);
+    void spawnTracers(Input const& input);
+    void drawMesh(Snapshot const& snapshot, TracerPool::Style const& style);
+    void drawPaths(Snapshot const& snapshot, TracerPool::Style const& style);
+    void drawSparks(Snapshot const& snapshot, TracerPool::Style const& style);
+
+    TracerPool tracers;
+    JobSystem jobs;
+    Profiler* profiler = nullptr;
+    std::atomic<StreamSender*> sender = {nullptr};
+    // What the pool was last set to, so a tick only acts on changes.
+    uint64_t strokeGeneration = 0;
+    ofVec3f velocity;
+    int threadCount = 1;
+
+    std::mutex inputMutex;
+    Input input;
+    // Kept out of Input so ticks do not copy it.
+    TracerPool::Pipeline pipeline;
+    bool pipelineChanged = false;
+
+    std::thread thread;
+    std::mutex runMutex;
+    std::condition_variable stopRequested;
+    bool stopping = false;
+
+    TripleBuffer<Snapshot> snapshots;
+    std::atomic<uint64_t> ticks = {0};
+    std::atomic<float> tickMillis = {0};
+    struct UploadedStroke {
+        ofVbo vbo;
+        int indices = 0;
+        int copies = 0;
+    };
+    std::vector<UploadedStroke> strokes;
+    uint64_t uploadedTick = 0;
+    uint64_t drawnNanos = 0;
+    ofMesh sparkPoints;
+};
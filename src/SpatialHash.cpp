@@ -0,0 +1,58 @@
+#include "SpatialHash.h"
+
+void SpatialHash::build(ofVec3f const* points, size_t count, float cellSize) {
+    inverseCellSize = 1 / cellSize;
+    // Twice as many buckets as points keeps most buckets to a single cell.
+    uint32_t size = 1;
+    while (size < 2 * count) {
+        size <<= 1;
+    }
+    mask = size - 1;
+    starts.assign(size + 1, 0);
+    entries.resize(count);
+    pointBuckets.resize(count);
+
+    for (size_t i = 0; i < count; i++) {
+        uint32_t const bucket = getBucket(getCell(points[i].x), getCell(points[i].y), getCell(points[i].z));
+        pointBuckets[i] = bucket;
+        starts[bucket + 1]++;
+    }
+    for (uint32_t b = 0; b < size; b++) {
+        starts[b + 1] += starts[b];
+    }
+    // Placing advances each start to the next bucket's, so shift them back after.
+    for (size_t i = 0; i < count; i++) {
+        entries[starts[pointBuckets[i]]++] = i;
+    }
+    for (uint32_t b = size; b > 0; b--) {
+        starts[b] = starts[b - 1];
+    }
+    starts[0] = 0;
+}
+
+int SpatialHash::getNearBuckets(ofVec3f const& position, uint32_t* buckets) const {
+    int const x = getCell(position.x);
+    int const y = getCell(position.y);
+    int const z = getCell(position.z);
+    int found = 0;
+    for (int dx = -1; dx <= 1; dx++) {
+        for (int dy = -1; dy <= 1; dy++) {
+            for (int dz = -1; dz <= 1; dz++) {
+                uint32_t const bucket = getBucket(x + dx, y + dy, z + dz);
+                // Two cells can share a bucket; visiting it twice would count its points twice.
+                if (std::find(buckets, buckets + found, bucket) == buckets + found) {
+                    buckets[found++] = bucket;
+                }
+            }
+        }
+    }
+    return found;
+}
+
+uint32_t SpatialHash::getBucket(int x, int y, int z) const {
+    return ((uint32_t)x * 73856093u ^ (uint32_t)y * 19349663u ^ (uint32_t)z * 83492791u) & mask;
+}
+
+int SpatialHash::getCell(float coordinate) const {
+    return std::floor(coordinate * inverseCellSize);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Points bucketed into a uniform grid of cubic cells, with the cells hashed
+// into a table sized to the point count so the grid needs no bounds.
+// build() counting-sorts the points by cell in O(n) into buffers it keeps,
+// and a query only looks at the 27 cells around a position, so finding
+// every point's neighbors is O(n) as long as cells stay sparsely filled.
+class SpatialHash {
+public:
+    void build(ofVec3f const* points, size_t count, float cellSize);
+
+    // Calls visit(index) once for every point within cellSize of position,
+    // and some a little further away; callers check the distance.
+    template <typename Visit>
+    void forEachNear(ofVec3f const& position, Visit const& visit) const {
+        uint32_t buckets[27];
+        int const found = getNearBuckets(position, buckets);
+        for (int b = 0; b < found; b++) {
+            for (uint32_t i = starts[buckets[b]]; i < starts[buckets[b] + 1]; i++) {
+                visit(entries[i]);
+            }
+        }
+    }
+
+private:
+    // Fills buckets with the distinct buckets of the 27 cells around position.
+    int getNearBuckets(ofVec3f const& position, uint32_t* buckets) const;
+    uint32_t getBucket(int x, int y, int z) const;
+    int getCell(float coordinate) const;
+
+    float inverseCellSize = 1;
+    uint32_t mask = 0;
+    // Bucket b holds entries [starts[b], starts[b + 1]).
+    std::vector<uint32_t> starts;
+    std::vector<uint32_t> entries;
+    std::vector<uint32_t> pointBuckets;
+};
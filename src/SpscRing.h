@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+// Lock-free ring between exactly one producer thread and one consumer thread.
+// Neither side allocates or blocks, so the producer may be an audio or MIDI
+// callback. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscRing {
+public:
+    SpscRing(size_t capacity = 1024) {
+        size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        items.resize(size);
+        mask = size - 1;
+    }
+
+    size_t capacity() const {
+        return items.size();
+    }
+
+    // Consumer-side count; the producer may have added more since.
+    size_t size() const {
+        return writeIndex.load(std::memory_order_acquire) - readIndex.load(std::memory_order_relaxed);
+    }
+
+    bool push(T const& item) {
+        return push(&item, 1) == 1;
+    }
+
+    // Returns how many items fit; the rest are dropped.
+    size_t push(T const* source, size_t count) {
+        size_t const write = writeIndex.load(std::memory_order_relaxed);
+        size_t const read = readIndex.load(std::memory_order_acquire);
+        count = std::min(count, items.size() - (write - read));
+        for (size_t i = 0; i < count; i++) {
+            items[(write + i) & mask] = source[i];
+        }
+        writeIndex.store(write + count, std::memory_order_release);
+        return count;
+    }
+
+    bool pop(T& item) {
+        return pop(&item, 1) == 1;
+    }
+
+    size_t pop(T* destination, size_t count) {
+        size_t const read = readIndex.load(std::memory_order_relaxed);
+        size_t const write = writeIndex.load(std::memory_order_acquire);
+        count = std::min(count, write - read);
+        for (size_t i = 0; i < count; i++) {
+            destination[i] = items[(read + i) & mask];
+        }
+        readIndex.store(read + count, std::memory_order_release);
+        return count;
+    }
+
+private:
+    std::vector<T> items;
+    size_t mask;
+    // Apart so producer and consumer do not share a cache line.
+    alignas(64) std::atomic<size_t> writeIndex{0};
+    alignas(64) std::atomic<size_t> readIndex{0};
+};
@@ -0,0 +1,64 @@
+#include "StreamOptions.h"
+#include <cctype>
+
+namespace {
+
+void printUsage() {
+    std::cerr << "usage: Tracer --stream-to address[,address...] | --render-node address [--view-angle degrees]" << std::endl;
+}
+
+}
+
+bool StreamOptions::isStreaming() const {
+    return !destinations.empty();
+}
+
+bool StreamOptions::isRenderNode() const {
+    return !listenAddress.empty();
+}
+
+std::string StreamOptions::getNodeName() const {
+    std::string name;
+    for (char c : listenAddress) {
+        if (isalnum((unsigned char)c)) {
+            name += c;
+        } else if (!name.empty() && name.back() != '-') {
+            name += '-';
+        }
+    }
+    if (!name.empty() && name.back() == '-') {
+        name.pop_back();
+    }
+    return name;
+}
+
+bool StreamOptions::parse(int& argc, char**& argv, StreamOptions& options) {
+    while (argc >= 2) {
+        std::string const option = argv[1];
+        if (option != "--stream-to" && option != "--render-node" && option != "--view-angle") {
+            break;
+        }
+        if (argc < 3) {
+            printUsage();
+            return false;
+        }
+
+        std::string const value = argv[2];
+        if (option == "--stream-to") {
+            options.destinations = ofSplitString(value, ",", true, true);
+        } else if (option == "--render-node") {
+            options.listenAddress = value;
+        } else {
+            options.viewAngle = atof(value.c_str());
+        }
+        argv[2] = argv[0];
+        argc -= 2;
+        argv += 2;
+    }
+
+    if (options.isStreaming() && options.isRenderNode()) {
+        printUsage();
+        return false;
+    }
+    return true;
+}
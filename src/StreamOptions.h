@@ -0,0 +1,26 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Settings for splitting a show across processes or machines: one node
+// runs the simulation and streams it, render nodes draw what they receive.
+struct StreamOptions {
+    // Render nodes to stream to, each "host:port" or "unix:/path".
+    std::vector<std::string> destinations;
+    // Where a render node listens: a UDP port, "host:port" or "unix:/path".
+    std::string listenAddress;
+    // Degrees a render node turns the scene by, to show another side of the box.
+    float viewAngle = 0;
+
+    bool isStreaming() const;
+    bool isRenderNode() const;
+    // The listen address with anything but letters and digits turned into
+    // dashes, e.g. "unix-tmp-tracer-back", so render nodes on one machine
+    // can publish video under names of their own. Empty for other nodes.
+    std::string getNodeName() const;
+
+    // Reads "--stream-to address[,address...]" or "--render-node address
+    // [--view-angle degrees]" from the front of argv and removes them.
+    // Returns false and prints usage if they are malformed.
+    static bool parse(int& argc, char**& argv, StreamOptions& options);
+};
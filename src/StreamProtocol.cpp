@@ -0,0 +1,38 @@
+#include "StreamProtocol.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/un.h>
+
+bool StreamProtocol::parseAddress(std::string const& text, sockaddr_storage& address, socklen_t& length) {
+    memset(&address, 0, sizeof(address));
+    std::string const unixPrefix = "unix:";
+    if (text.compare(0, unixPrefix.size(), unixPrefix) == 0) {
+        auto& local = reinterpret_cast<sockaddr_un&>(address);
+        std::string const path = text.substr(unixPrefix.size());
+        if (path.empty() || path.size() >= sizeof(local.sun_path)) {
+            return false;
+        }
+        local.sun_family = AF_UNIX;
+        memcpy(local.sun_path, path.c_str(), path.size() + 1);
+        length = sizeof(local);
+        return true;
+    }
+
+    size_t const colon = text.rfind(':');
+    std::string const host = colon == std::string::npos ? "" : text.substr(0, colon);
+    std::string const port = colon == std::string::npos ? text : text.substr(colon + 1);
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    hints.ai_flags = host.empty() ? AI_PASSIVE : 0;
+    addrinfo* found = nullptr;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(), &hints, &found) != 0 || found == nullptr) {
+        return false;
+    }
+    memcpy(&address, found->ai_addr, found->ai_addrlen);
+    length = found->ai_addrlen;
+    freeaddrinfo(found);
+    return true;
+}
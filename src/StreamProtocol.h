@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <sys/socket.h>
+
+// Wire format of the simulation stream: one datagram per simulation tick,
+// from the node that runs the simulation to each render node.
+//
+// A datagram is a Header, propertyCount PropertyValues, then tracerCount
+// heads. A keyframe carries each head as three floats and every
+// performance property. Otherwise each head is three int16 steps of QUANTUM
+// from the head the previous datagram left the render node with, and only
+// properties that changed are sent. A render node that misses a datagram
+// ignores steps until the next keyframe.
+namespace StreamProtocol {
+    uint32_t const MAGIC = 0x54535254; // "TRST"
+    uint16_t const VERSION = 1;
+    uint16_t const KEYFRAME = 1;
+    // A head steps far less than this per tick; a step that does not fit
+    // in an int16 forces a keyframe.
+    float const QUANTUM = 1.0f / 64;
+    // The most a UDP datagram carries.
+    size_t const MAX_DATAGRAM_BYTES = 65507;
+
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t flags;
+        uint64_t tick;
+        // steady_clock nanoseconds when the tick was sent; comparable
+        // between processes on one machine.
+        uint64_t sentNanos;
+        // The simulation node's clock at the tick.
+        float millis;
+        uint16_t tracerCount;
+        uint16_t propertyCount;
+    };
+
+    struct PropertyValue {
+        // Index into the app's performance properties.
+        uint16_t index;
+        uint16_t reserved;
+        float scale;
+    };
+
+    // Reads "host:port" or "unix:/path" into address. A bare port means
+    // every interface, for listening.
+    bool parseAddress(std::string const& text, sockaddr_storage& address, socklen_t& length);
+}
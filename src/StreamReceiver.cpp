@@ -0,0 +1,123 @@
+#include "StreamReceiver.h"
+#include <cstring>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace StreamProtocol;
+
+StreamReceiver::~StreamReceiver() {
+    close();
+}
+
+bool StreamReceiver::open(std::string const& address) {
+    close();
+    sockaddr_storage local;
+    socklen_t length;
+    if (!parseAddress(address, local, length)) {
+        ofLogError("StreamReceiver") << "Cannot resolve " << address;
+        return false;
+    }
+    if (local.ss_family == AF_UNIX) {
+        // A socket file left by an earlier run would make bind() fail.
+        unixPath = reinterpret_cast<sockaddr_un&>(local).sun_path;
+        unlink(unixPath.c_str());
+    }
+
+    socket = ::socket(local.ss_family, SOCK_DGRAM, 0);
+    if (socket < 0 || bind(socket, reinterpret_cast<sockaddr*>(&local), length) != 0) {
+        ofLogError("StreamReceiver") << "Cannot listen on " << address << ": " << strerror(errno);
+        close();
+        return false;
+    }
+    // A render node drawing slower than the simulation ticks has a backlog
+    // to drain each frame.
+    int const receiveBufferBytes = 4 * MAX_DATAGRAM_BYTES;
+    setsockopt(socket, SOL_SOCKET, SO_RCVBUF, &receiveBufferBytes, sizeof(receiveBufferBytes));
+    buffer.resize(MAX_DATAGRAM_BYTES);
+    synced = false;
+    return true;
+}
+
+void StreamReceiver::close() {
+    if (socket >= 0) {
+        ::close(socket);
+        socket = -1;
+    }
+    if (!unixPath.empty()) {
+        unlink(unixPath.c_str());
+        unixPath.clear();
+    }
+}
+
+bool StreamReceiver::receive(Tick& tick) {
+    while (socket >= 0) {
+        ssize_t const size = recv(socket, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (size < 0) {
+            return false;
+        }
+        stats.bytes += size;
+
+        Header header;
+        if ((size_t)size < sizeof(header)) {
+            continue;
+        }
+        memcpy(&header, buffer.data(), sizeof(header));
+        bool const keyframe = header.flags & KEYFRAME;
+        size_t const expected = sizeof(Header) + header.propertyCount * sizeof(PropertyValue)
+            + header.tracerCount * (keyframe ? sizeof(float[3]) : sizeof(int16_t[3]));
+        if (header.magic != MAGIC || header.version != VERSION || (size_t)size != expected) {
+            continue;
+        }
+
+        if (synced && header.tick <= lastTick) {
+            // Late or repeated; the heads have already moved past it. A late
+            // keyframe would rewind them, so it is dropped too.
+            continue;
+        }
+        if (lastTick > 0 && header.tick > lastTick + 1) {
+            stats.lost += header.tick - lastTick - 1;
+            synced = false;
+        }
+        if (!keyframe && (!synced || header.tracerCount > heads.size())) {
+            stats.skipped++;
+            lastTick = header.tick;
+            continue;
+        }
+
+        uint8_t const* data = buffer.data() + sizeof(Header);
+        tick.properties.resize(header.propertyCount);
+        memcpy(tick.properties.data(), data, header.propertyCount * sizeof(PropertyValue));
+        data += header.propertyCount * sizeof(PropertyValue);
+        if (keyframe) {
+            heads.resize(header.tracerCount);
+            for (size_t i = 0; i < heads.size(); i++) {
+                memcpy(heads[i].getPtr(), data + i * sizeof(float[3]), sizeof(float[3]));
+            }
+        } else {
+            heads.resize(header.tracerCount);
+            for (size_t i = 0; i < heads.size(); i++) {
+                for (int axis = 0; axis < 3; axis++) {
+                    int16_t quantized;
+                    memcpy(&quantized, data + (3 * i + axis) * sizeof(int16_t), sizeof(quantized));
+                    // Must match StreamSender exactly, or the error would build up.
+                    heads[i][axis] += quantized * QUANTUM;
+                }
+            }
+        }
+
+        synced = true;
+        lastTick = header.tick;
+        stats.ticks++;
+        tick.tick = header.tick;
+        tick.sentNanos = header.sentNanos;
+        tick.millis = header.millis;
+        tick.heads = heads.data();
+        tick.tracerCount = heads.size();
+        return true;
+    }
+    return false;
+}
+
+StreamReceiver::Stats StreamReceiver::getStats() const {
+    return stats;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ofMain.h"
+#include "StreamProtocol.h"
+
+// A render node's end of the simulation stream: rebuilds each tick's heads
+// from the datagrams StreamSender sends; see StreamProtocol.
+class StreamReceiver {
+public:
+    struct Tick {
+        uint64_t tick = 0;
+        uint64_t sentNanos = 0;
+        float millis = 0;
+        // Valid until the next receive().
+        ofVec3f const* heads = nullptr;
+        size_t tracerCount = 0;
+        std::vector<StreamProtocol::PropertyValue> properties;
+    };
+
+    struct Stats {
+        uint64_t ticks = 0;
+        // Ticks that never arrived.
+        uint64_t lost = 0;
+        // Ticks that arrived but could not be rebuilt while waiting for a keyframe.
+        uint64_t skipped = 0;
+        uint64_t bytes = 0;
+    };
+
+    ~StreamReceiver();
+
+    // A UDP port, "host:port" or "unix:/path".
+    bool open(std::string const& address);
+    void close();
+    // The next tick that arrived, without waiting. False once there is none.
+    bool receive(Tick& tick);
+    Stats getStats() const;
+
+private:
+    int socket = -1;
+    std::string unixPath;
+    std::vector<uint8_t> buffer;
+    std::vector<ofVec3f> heads;
+    // Whether heads match the sender's, so steps can apply to them.
+    bool synced = false;
+    uint64_t lastTick = 0;
+    Stats stats;
+};
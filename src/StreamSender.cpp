@@ -0,0 +1,159 @@
+#include "StreamSender.h"
+#include <chrono>
+#include <cstring>
+#include <unistd.h>
+
+using namespace StreamProtocol;
+
+StreamSender::~StreamSender() {
+    close();
+}
+
+bool StreamSender::open(std::vector<std::string> const& addresses) {
+    close();
+    for (auto const& text : addresses) {
+        Destination destination;
+        if (!parseAddress(text, destination.address, destination.addressLength)) {
+            ofLogError("StreamSender") << "Cannot resolve " << text;
+            close();
+            return false;
+        }
+        destination.socket = socket(destination.address.ss_family, SOCK_DGRAM, 0);
+        if (destination.socket < 0) {
+            ofLogError("StreamSender") << "Cannot open a socket for " << text << ": " << strerror(errno);
+            close();
+            return false;
+        }
+        destinations.push_back(destination);
+    }
+    buffer.resize(MAX_DATAGRAM_BYTES);
+    sentAny = false;
+    return !destinations.empty();
+}
+
+void StreamSender::close() {
+    for (auto const& destination : destinations) {
+        ::close(destination.socket);
+    }
+    destinations.clear();
+}
+
+bool StreamSender::isOpen() const {
+    return !destinations.empty();
+}
+
+void StreamSender::setProperty(int index, float scale) {
+    std::lock_guard<std::mutex> lock(propertyMutex);
+    if ((size_t)index >= propertyScales.size()) {
+        propertyScales.resize(index + 1, 0);
+        propertyChanged.resize(index + 1, true);
+    }
+    if (propertyScales[index] != scale) {
+        propertyScales[index] = scale;
+        propertyChanged[index] = true;
+    }
+}
+
+void StreamSender::send(uint64_t tick, float millis, ofVec3f const* heads, size_t count) {
+    if (destinations.empty()) {
+        return;
+    }
+
+    bool keyframe = !sentAny || tick - lastKeyframe >= KEYFRAME_TICKS || count > sentHeads.size();
+    collectProperties(keyframe);
+    // Keyframes need the most room; past this the tick cannot fit one datagram.
+    size_t const propertyBytes = properties.size() * sizeof(PropertyValue);
+    size_t const maxTracers = std::min<size_t>(UINT16_MAX, (MAX_DATAGRAM_BYTES - sizeof(Header) - propertyTotal * sizeof(PropertyValue)) / sizeof(float[3]));
+    if (count > maxTracers) {
+        ofLogWarning("StreamSender") << "Streaming only " << maxTracers << " of " << count << " tracers";
+        count = maxTracers;
+    }
+
+    uint8_t* tracerData = buffer.data() + sizeof(Header) + propertyBytes;
+    if (!keyframe && !writeSteps(heads, count, tracerData)) {
+        keyframe = true;
+        collectProperties(true);
+        tracerData = buffer.data() + sizeof(Header) + properties.size() * sizeof(PropertyValue);
+    }
+    if (keyframe) {
+        sentHeads.assign(heads, heads + count);
+        for (size_t i = 0; i < count; i++) {
+            memcpy(tracerData + i * sizeof(float[3]), heads[i].getPtr(), sizeof(float[3]));
+        }
+        lastKeyframe = tick;
+    }
+    memcpy(buffer.data() + sizeof(Header), properties.data(), properties.size() * sizeof(PropertyValue));
+
+    Header header = {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.flags = keyframe ? KEYFRAME : 0;
+    header.tick = tick;
+    header.sentNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    header.millis = millis;
+    header.tracerCount = count;
+    header.propertyCount = properties.size();
+    memcpy(buffer.data(), &header, sizeof(header));
+
+    size_t const size = sizeof(Header) + properties.size() * sizeof(PropertyValue) + count * (keyframe ? sizeof(float[3]) : sizeof(int16_t[3]));
+    for (auto const& destination : destinations) {
+        ssize_t const sent = sendto(destination.socket, buffer.data(), size, MSG_DONTWAIT,
+            reinterpret_cast<sockaddr const*>(&destination.address), destination.addressLength);
+        if (sent == (ssize_t)size) {
+            bytes += size;
+        } else {
+            dropped++;
+        }
+    }
+    sentAny = true;
+    ticks++;
+    if (keyframe) {
+        keyframes++;
+    }
+}
+
+void StreamSender::collectProperties(bool all) {
+    std::lock_guard<std::mutex> lock(propertyMutex);
+    properties.clear();
+    propertyTotal = propertyScales.size();
+    for (size_t i = 0; i < propertyScales.size(); i++) {
+        if (all || propertyChanged[i]) {
+            properties.push_back({(uint16_t)i, 0, propertyScales[i]});
+            propertyChanged[i] = false;
+        }
+    }
+}
+
+bool StreamSender::writeSteps(ofVec3f const* heads, size_t count, uint8_t* out) {
+    for (size_t i = 0; i < count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            float const step = std::round((heads[i][axis] - sentHeads[i][axis]) / QUANTUM);
+            if (std::abs(step) > INT16_MAX) {
+                return false;
+            }
+            int16_t const quantized = step;
+            memcpy(out + (3 * i + axis) * sizeof(int16_t), &quantized, sizeof(quantized));
+        }
+    }
+
+    // Only once every step fits, so a keyframe can still start from scratch.
+    sentHeads.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            int16_t quantized;
+            memcpy(&quantized, out + (3 * i + axis) * sizeof(int16_t), sizeof(quantized));
+            // Must match StreamReceiver exactly, or the error would build up.
+            sentHeads[i][axis] += quantized * QUANTUM;
+        }
+    }
+    return true;
+}
+
+StreamSender::Stats StreamSender::getStats() const {
+    Stats stats;
+    stats.ticks = ticks;
+    stats.keyframes = keyframes;
+    stats.bytes = bytes;
+    stats.dropped = dropped;
+    return stats;
+}
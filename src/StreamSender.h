@@ -0,0 +1,70 @@
+#pragma once
+
+#include "ofMain.h"
+#include "StreamProtocol.h"
+#include <atomic>
+#include <mutex>
+
+// Sends each simulation tick to render nodes, one datagram per node per
+// tick; see StreamProtocol. Sends never block: a datagram a node's socket
+// has no room for is dropped, and the next keyframe repairs it.
+class StreamSender {
+public:
+    struct Stats {
+        uint64_t ticks = 0;
+        uint64_t keyframes = 0;
+        uint64_t bytes = 0;
+        // Datagrams the socket refused.
+        uint64_t dropped = 0;
+    };
+
+    ~StreamSender();
+
+    // Each destination is "host:port" or "unix:/path". Returns false and
+    // sends nowhere if any of them cannot be opened.
+    bool open(std::vector<std::string> const& destinations);
+    void close();
+    bool isOpen() const;
+
+    // Main thread, every frame: the sender passes on only what changed.
+    void setProperty(int index, float scale);
+    // Simulation thread, after each tick.
+    void send(uint64_t tick, float millis, ofVec3f const* heads, size_t count);
+    Stats getStats() const;
+
+private:
+    // A keyframe at least this often repairs nodes that missed a datagram.
+    uint64_t const KEYFRAME_TICKS = 30;
+
+    struct Destination {
+        int socket;
+        sockaddr_storage address;
+        socklen_t addressLength;
+    };
+
+    // Every property on a keyframe, otherwise the ones that changed.
+    void collectProperties(bool all);
+    // Writes heads as steps from sentHeads, advancing sentHeads exactly as
+    // a render node will. False if a step does not fit.
+    bool writeSteps(ofVec3f const* heads, size_t count, uint8_t* out);
+
+    std::vector<Destination> destinations;
+
+    std::mutex propertyMutex;
+    std::vector<float> propertyScales;
+    std::vector<bool> propertyChanged;
+
+    // What render nodes hold after the last datagram.
+    std::vector<ofVec3f> sentHeads;
+    uint64_t lastKeyframe = 0;
+    bool sentAny = false;
+    std::vector<uint8_t> buffer;
+    std::vector<StreamProtocol::PropertyValue> properties;
+    // Properties a keyframe carries.
+    size_t propertyTotal = 0;
+
+    std::atomic<uint64_t> ticks = {0};
+    std::atomic<uint64_t> keyframes = {0};
+    std::atomic<uint64_t> bytes = {0};
+    std::atomic<uint64_t> dropped = {0};
+};
@@ -0,0 +1,79 @@
+#include "StrokeCache.h"
+#include "StrokeMesh.h"
+
+void StrokeCache::invalidate() {
+    valid = false;
+}
+
+void StrokeCache::reserve(int maxPoints) {
+    size_t const samples = maxPoints * StrokeMesh::samplesPerSegment(MAX_RESOLUTION);
+    if (positions.size() < samples) {
+        positions.resize(samples);
+        directions.resize(samples);
+    }
+}
+
+int StrokeCache::update(PointHistory const& history, size_t tracer, int curveResolution, int maxPoints) {
+    size_t const count = history.size(tracer);
+    uint64_t const oldest = history.getPushed(tracer) - count;
+    // A segment needs the points on either side of it, so the first and
+    // last held points only ever act as control points.
+    uint64_t const first = oldest + 1;
+    uint64_t const last = count >= 4 ? oldest + count - 2 : first;
+    int const wantedResolution = ofClamp(curveResolution, 1, MAX_RESOLUTION);
+
+    if (!valid || wantedResolution != resolution || last - first > (uint64_t)capacity || end > last) {
+        resolution = wantedResolution;
+        capacity = std::max<int>(maxPoints, last - first);
+        size_t const samples = capacity * StrokeMesh::samplesPerSegment(resolution);
+        if (positions.size() < samples) {
+            positions.resize(samples);
+            directions.resize(samples);
+        }
+        begin = first;
+        end = first;
+        valid = true;
+    }
+
+    begin = std::max(begin, first);
+    end = std::max(end, begin);
+    int const samples = StrokeMesh::samplesPerSegment(resolution);
+    int tessellated = 0;
+    for (; end < last; end++, tessellated++) {
+        size_t const index = end - oldest;
+        size_t const slot = (end % capacity) * samples;
+        StrokeMesh::tessellateSegment(history.at(tracer, index - 1), history.at(tracer, index), history.at(tracer, index + 1), history.at(tracer, index + 2), resolution, &positions[slot], &directions[slot]);
+    }
+    return tessellated;
+}
+
+size_t StrokeCache::getSegmentCount() const {
+    return end - begin;
+}
+
+void StrokeCache::appendTo(ofMesh& mesh) const {
+    if (end == begin) {
+        return;
+    }
+
+    int const samples = StrokeMesh::samplesPerSegment(resolution);
+    for (uint64_t segment = begin; segment < end; segment++) {
+        size_t const slot = (segment % capacity) * samples;
+        StrokeMesh::appendRibbon(mesh, &positions[slot], &directions[slot], samples);
+    }
+
+    size_t const head = (begin % capacity) * samples;
+    size_t const tail = ((end - 1) % capacity) * samples + samples - 1;
+    StrokeMesh::appendCap(mesh, positions[head], -directions[head]);
+    StrokeMesh::appendCap(mesh, positions[tail], directions[tail]);
+}
+
+void StrokeCache::appendCenterline(ofPolyline& line) const {
+    int const samples = StrokeMesh::samplesPerSegment(resolution);
+    for (uint64_t segment = begin; segment < end; segment++) {
+        // Each segment starts where the one before it ended.
+        int const skip = segment > begin ? 1 : 0;
+        size_t const slot = (segment % capacity) * samples;
+        line.addVertices(&positions[slot + skip], samples - skip);
+    }
+}
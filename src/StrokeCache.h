@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+#include "PointHistory.h"
+
+// One tracer's tessellated curve, kept as a ring of segments that follows
+// its PointHistory. Segment s is the Catmull-Rom span between points s and
+// s + 1. Each update only tessellates segments that new points completed
+// and forgets segments whose points were trimmed, so a frame of a long
+// trail costs the same as a short one.
+class StrokeCache {
+public:
+    // Samples per segment are capped; a segment spans one frame of movement.
+    static int const MAX_RESOLUTION = 8;
+
+    void invalidate();
+    // Sizes the buffers for the longest history, so update() never allocates.
+    void reserve(int maxPoints);
+    // Returns how many segments it tessellated.
+    int update(PointHistory const& history, size_t tracer, int curveResolution, int maxPoints);
+    size_t getSegmentCount() const;
+    // Appends the segments oldest first, with round caps at both ends.
+    void appendTo(ofMesh& mesh) const;
+    // Appends the same curve's samples, for renderers that stroke it themselves.
+    void appendCenterline(ofPolyline& line) const;
+
+private:
+    int resolution = 0;
+    int capacity = 0;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+    bool valid = false;
+    std::vector<ofVec3f> positions;
+    std::vector<ofVec3f> directions;
+};
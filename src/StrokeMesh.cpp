@@ -0,0 +1,165 @@
+#include "StrokeMesh.h"
+
+namespace {
+
+char const* const STROKE_VERTEX_SHADER = R"(
+#version 120
+uniform vec3 viewNormal;
+uniform float halfWidth;
+// Per instance: where this copy of the stroke sits relative to the stroke.
+attribute vec3 instanceOffset;
+varying vec2 corner;
+void main() {
+    vec3 direction = normalize(gl_Normal);
+    vec3 across = cross(direction, viewNormal);
+    float acrossLength = length(across);
+    across = acrossLength > 1e-4 ? across / acrossLength : vec3(0.0);
+    vec3 offset = (across * gl_MultiTexCoord0.x + direction * gl_MultiTexCoord0.y) * halfWidth;
+    gl_Position = gl_ModelViewProjectionMatrix * vec4(gl_Vertex.xyz + instanceOffset + offset, 1.0);
+    gl_FrontColor = gl_Color;
+    corner = gl_MultiTexCoord0.xy;
+}
+)";
+
+// The corner's length is 0 on the centerline and 1 at the stroke's edge,
+// across ribbons and out from cap hubs alike, so fading the last pixel
+// before 1 anti-aliases every edge.
+char const* const STROKE_FRAGMENT_SHADER = R"(
+#version 120
+varying vec2 corner;
+void main() {
+    float fromCenter = length(corner);
+    float coverage = clamp((1.0 - fromCenter) / max(fwidth(fromCenter), 1e-4), 0.0, 1.0);
+    gl_FragColor = vec4(gl_Color.rgb, gl_Color.a * coverage);
+}
+)";
+
+ofShader& getShader() {
+    static ofShader shader;
+    if (!shader.isLoaded()) {
+        shader.setupShaderFromSource(GL_VERTEX_SHADER, STROKE_VERTEX_SHADER);
+        shader.setupShaderFromSource(GL_FRAGMENT_SHADER, STROKE_FRAGMENT_SHADER);
+        shader.linkProgram();
+    }
+    return shader;
+}
+
+}
+
+char const* StrokeMesh::getBackendName(Backend backend) {
+    switch (backend) {
+        case MESH:
+            return "mesh";
+        case SHIVA_VG:
+            return "shivavg";
+        case GL_LINES:
+            return "gl";
+        default:
+            return "unknown";
+    }
+}
+
+StrokeMesh::Backend StrokeMesh::findBackend(std::string const& name) {
+    int backend = 0;
+    while (backend < BACKEND_COUNT && name != getBackendName((Backend)backend)) {
+        backend++;
+    }
+    return (Backend)backend;
+}
+
+int StrokeMesh::samplesPerSegment(int resolution) {
+    return resolution + 1;
+}
+
+size_t StrokeMesh::bytesPerVertex() {
+    return 2 * sizeof(ofVec3f) + sizeof(ofVec2f);
+}
+
+void StrokeMesh::tessellateSegment(ofVec3f const& p0, ofVec3f const& p1, ofVec3f const& p2, ofVec3f const& p3, int resolution, ofVec3f* positions, ofVec3f* directions) {
+    // Uniform Catmull-Rom, as ofPolyline::curveTo draws it.
+    ofVec3f const b = p2 - p0;
+    ofVec3f const c = p0 * 2 - p1 * 5 + p2 * 4 - p3;
+    ofVec3f const d = p1 * 3 - p0 - p2 * 3 + p3;
+    ofVec3f const chord = (p2 - p1).getNormalized();
+    for (int i = 0; i <= resolution; i++) {
+        float const t = float(i) / resolution;
+        positions[i] = p1 + (b * t + c * (t * t) + d * (t * t * t)) * 0.5;
+        ofVec3f const tangent = b + c * (2 * t) + d * (3 * t * t);
+        directions[i] = tangent.lengthSquared() > 1e-12 ? tangent.getNormalized() : chord;
+    }
+}
+
+void StrokeMesh::appendRibbon(ofMesh& mesh, ofVec3f const* positions, ofVec3f const* directions, int samples) {
+    auto& vertices = mesh.getVertices();
+    auto& normals = mesh.getNormals();
+    auto& corners = mesh.getTexCoords();
+    auto& indices = mesh.getIndices();
+    ofIndexType const first = vertices.size();
+    for (int i = 0; i < samples; i++) {
+        vertices.push_back(positions[i]);
+        vertices.push_back(positions[i]);
+        normals.push_back(directions[i]);
+        normals.push_back(directions[i]);
+        corners.push_back(ofVec2f(1, 0));
+        corners.push_back(ofVec2f(-1, 0));
+    }
+    for (int i = 0; i + 1 < samples; i++) {
+        ofIndexType const left = first + 2 * i;
+        indices.push_back(left);
+        indices.push_back(left + 1);
+        indices.push_back(left + 2);
+        indices.push_back(left + 1);
+        indices.push_back(left + 3);
+        indices.push_back(left + 2);
+    }
+}
+
+void StrokeMesh::appendCap(ofMesh& mesh, ofVec3f const& center, ofVec3f const& outward) {
+    // Half disc from one side through outward to the other.
+    auto& vertices = mesh.getVertices();
+    auto& normals = mesh.getNormals();
+    auto& corners = mesh.getTexCoords();
+    auto& indices = mesh.getIndices();
+    ofIndexType const hub = vertices.size();
+    vertices.push_back(center);
+    normals.push_back(outward);
+    corners.push_back(ofVec2f(0, 0));
+    for (int k = 0; k <= CAP_SEGMENTS; k++) {
+        float const angle = PI * k / CAP_SEGMENTS;
+        vertices.push_back(center);
+        normals.push_back(outward);
+        corners.push_back(ofVec2f(cos(angle), sin(angle)));
+    }
+    for (int k = 0; k < CAP_SEGMENTS; k++) {
+        indices.push_back(hub);
+        indices.push_back(hub + 1 + k);
+        indices.push_back(hub + 2 + k);
+    }
+}
+
+void StrokeMesh::begin(float width, ofVec3f const& viewNormal) {
+    auto& shader = getShader();
+    shader.begin();
+    shader.setUniform3f("viewNormal", viewNormal.x, viewNormal.y, viewNormal.z);
+    shader.setUniform1f("halfWidth", width * 0.5);
+}
+
+void StrokeMesh::end() {
+    getShader().end();
+}
+
+void StrokeMesh::upload(Instanced const& stroke, ofVbo& vbo) {
+    auto const& mesh = stroke.mesh;
+    vbo.setVertexData(mesh.getVertices().data(), mesh.getVertices().size(), GL_STREAM_DRAW);
+    vbo.setNormalData(mesh.getNormals().data(), mesh.getNormals().size(), GL_STREAM_DRAW);
+    vbo.setTexCoordData(mesh.getTexCoords().data(), mesh.getTexCoords().size(), GL_STREAM_DRAW);
+    vbo.setIndexData(mesh.getIndices().data(), mesh.getIndices().size(), GL_STREAM_DRAW);
+    int const location = getShader().getAttributeLocation("instanceOffset");
+    vbo.setAttributeData(location, &stroke.offsets[0].x, 3, stroke.offsets.size(), GL_STREAM_DRAW, sizeof(ofVec3f));
+    // Advance the offset once per copy rather than once per vertex.
+    vbo.setAttributeDivisor(location, 1);
+}
+
+void StrokeMesh::drawInstanced(ofVbo const& vbo, int indices, int copies) {
+    vbo.drawElementsInstanced(GL_TRIANGLES, indices, copies);
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Stroke geometry that stays valid while the view turns. Each vertex is a
+// centerline point, with a direction in its normal and a corner in its
+// texcoord. The stroke shader pushes each vertex corner.x across the
+// direction and corner.y along it, by half the stroke width, so ribbons
+// and their round caps always face the viewer. Copies of a stroke are
+// drawn instanced, each shifted by a per-instance offset, so they cost no
+// memory beyond the offsets.
+class StrokeMesh {
+public:
+    struct Stats {
+        uint64_t segments = 0;
+        uint64_t vertexBytes = 0;
+        // Strokes left out to keep a build under its vertex budget.
+        uint64_t droppedStrokes = 0;
+    };
+
+    // A tracer's stroke, tessellated once, and where to draw copies of it.
+    struct Instanced {
+        ofMesh mesh;
+        // One per copy to draw; the first is zero, for the stroke itself.
+        std::vector<ofVec3f> offsets;
+    };
+
+    // Ways to get trails on screen: everything as one mesh built here, or
+    // one path per tracer and copy, stroked by ShivaVG or as GL lines.
+    enum Backend {
+        MESH,
+        SHIVA_VG,
+        GL_LINES,
+        BACKEND_COUNT
+    };
+
+    static int const CAP_SEGMENTS = 8;
+
+    static char const* getBackendName(Backend backend);
+    // BACKEND_COUNT if no backend has that name.
+    static Backend findBackend(std::string const& name);
+
+    // Centerline samples per Catmull-Rom segment, both ends included.
+    static int samplesPerSegment(int resolution);
+    static size_t bytesPerVertex();
+
+    // Writes samplesPerSegment(resolution) points and unit directions along
+    // the Catmull-Rom span from p1 to p2.
+    static void tessellateSegment(ofVec3f const& p0, ofVec3f const& p1, ofVec3f const& p2, ofVec3f const& p3, int resolution, ofVec3f* positions, ofVec3f* directions);
+
+    // Appends a ribbon through the given samples.
+    static void appendRibbon(ofMesh& mesh, ofVec3f const* positions, ofVec3f const* directions, int samples);
+    // Appends a round cap at center bulging towards outward.
+    static void appendCap(ofMesh& mesh, ofVec3f const& center, ofVec3f const& outward);
+
+    // Binds the stroke shader around drawing meshes built here. The shader
+    // fades each stroke's outermost pixel through alpha, so edges only
+    // come out smooth with a blend mode that reads source alpha.
+    static void begin(float width, ofVec3f const& viewNormal);
+    static void end();
+    // Uploads a stroke and its copies' offsets for drawInstanced().
+    static void upload(Instanced const& stroke, ofVbo& vbo);
+    // Between begin() and end(): every copy of an uploaded stroke in one call.
+    static void drawInstanced(ofVbo const& vbo, int indices, int copies);
+};
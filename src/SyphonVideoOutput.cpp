@@ -0,0 +1,13 @@
+#include "SyphonVideoOutput.h"
+
+#ifdef TARGET_OSX
+
+SyphonVideoOutput::SyphonVideoOutput(std::string const& name) {
+    server.setName(name);
+}
+
+void SyphonVideoOutput::publishScreen(int width, int height) {
+    server.publishScreen();
+}
+
+#endif
@@ -0,0 +1,17 @@
+#pragma once
+
+#ifdef TARGET_OSX
+
+#include "VideoOutput.h"
+#include "ofxSyphon.h"
+
+class SyphonVideoOutput : public VideoOutput {
+public:
+    SyphonVideoOutput(std::string const& name);
+    void publishScreen(int width, int height) override;
+
+private:
+    ofxSyphonServer server;
+};
+
+#endif
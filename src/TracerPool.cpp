@@ -0,0 +1,535 @@
+#include "TracerPool.h"
+#include "BatchNoise.h"
+
+namespace {
+
+bool hasBox(ofVec3f const& halfSize) {
+    return halfSize.x > 0 && halfSize.y > 0 && halfSize.z > 0;
+}
+
+void projectOntoBox(ofVec3f& head, ofVec3f const& halfSize) {
+    float scale = std::max(std::abs(head.x) / halfSize.x, std::max(std::abs(head.y) / halfSize.y, std::abs(head.z) / halfSize.z));
+    if (scale > 0) {
+        head /= scale;
+    }
+}
+
+// Points a trail keeps before the next head is appended.
+int getKeep(int maxPoints, int capacity) {
+    return ofClamp(maxPoints, 1, capacity) - 1;
+}
+
+bool isInteracting(TracerPool::Frame const& frame) {
+    return frame.interactionRadius > 0 && (frame.repulsion > 0 || frame.flocking > 0 || frame.sparkDistance > 0);
+}
+
+// Squared distance between the closest points of segments a0-a1 and
+// b0-b1, with the point halfway between them in midpoint.
+float getSegmentDistanceSquared(ofVec3f const& a0, ofVec3f const& a1, ofVec3f const& b0, ofVec3f const& b1, ofVec3f& midpoint) {
+    ofVec3f const da = a1 - a0;
+    ofVec3f const db = b1 - b0;
+    ofVec3f const r = a0 - b0;
+    float const aa = da.dot(da);
+    float const bb = db.dot(db);
+    float const ab = da.dot(db);
+    float const ar = da.dot(r);
+    float const br = db.dot(r);
+    float const denominator = aa * bb - ab * ab;
+    // Parallel or degenerate segments take the start of a.
+    float s = denominator > 1e-9 ? ofClamp((ab * br - ar * bb) / denominator, 0, 1) : 0;
+    float t = bb > 1e-9 ? (ab * s + br) / bb : 0;
+    if (t < 0 || t > 1) {
+        t = ofClamp(t, 0, 1);
+        s = aa > 1e-9 ? ofClamp((ab * t - ar) / aa, 0, 1) : 0;
+    }
+    ofVec3f const onA = a0 + da * s;
+    ofVec3f const onB = b0 + db * t;
+    midpoint = (onA + onB) * 0.5;
+    return (onA - onB).lengthSquared();
+}
+
+}
+
+TracerPool::TracerPool(int maxPointsCapacity) : history(maxPointsCapacity) {
+}
+
+void TracerPool::reserve(size_t tracers) {
+    while (heads.size() < tracers) {
+        addSlot();
+    }
+}
+
+void TracerPool::addSlot() {
+    heads.push_back(ofVec3f(0, 0, 0));
+    velocities.push_back(ofVec3f(0, 0, 0));
+    timeShifts.push_back(ofVec3f(0, 0, 0));
+    displacements.push_back(ofVec3f(0, 0, 0));
+    interactionPositions.push_back(ofVec3f(0, 0, 0));
+    history.addTracer();
+    multiplierShifts.resize(multiplierShifts.size() + MAX_MULTIPLIER_COUNT);
+    strokeCaches.push_back(StrokeCache());
+    strokeCaches.back().reserve(history.getCapacity());
+}
+
+void TracerPool::spawn(ofVec3f const& head, ofVec3f const& timeShift, ofVec3f const& velocity) {
+    if (count == heads.size()) {
+        addSlot();
+    }
+
+    // The slot may hold a despawned tracer; reset everything it kept.
+    heads[count] = head;
+    velocities[count] = velocity;
+    timeShifts[count] = timeShift;
+    displacements[count] = ofVec3f(0, 0, 0);
+    history.clear(count);
+    auto firstShift = multiplierShifts.begin() + count * MAX_MULTIPLIER_COUNT;
+    std::fill(firstShift, firstShift + MAX_MULTIPLIER_COUNT, ofVec3f(0, 0, 0));
+    strokeCaches[count].invalidate();
+    count++;
+}
+
+void TracerPool::despawn() {
+    // Keep the slot's memory for the next spawn.
+    if (count > 0) {
+        count--;
+    }
+}
+
+size_t TracerPool::size() const {
+    return count;
+}
+
+size_t TracerPool::getCapacity() const {
+    return heads.size();
+}
+
+void TracerPool::setVelocity(ofVec3f const& velocity) {
+    std::fill(velocities.begin(), velocities.end(), velocity);
+}
+
+PointSpans TracerPool::getPoints(size_t tracer) const {
+    return history.spans(tracer);
+}
+
+TracerPool::Pipeline TracerPool::getDefaultPipeline() {
+    return {SET_HEADS_TO_ZERO, MOVE_WITH_PERLIN_NOISE, PROJECT_ONTO_BOX, INTERACT, LIMIT_LENGTH, GROW_FROM_HEADS, TESSELLATE_STROKES};
+}
+
+std::string TracerPool::getPassName(Pass pass) {
+    switch (pass) {
+        case SET_HEADS_TO_ZERO:
+            return "setHeadsToZero";
+        case MOVE_WITH_PERLIN_NOISE:
+            return "moveWithPerlinNoise";
+        case PROJECT_ONTO_BOX:
+            return "projectOntoBox";
+        case INTERACT:
+            return "interact";
+        case LIMIT_LENGTH:
+            return "limitLength";
+        case GROW_FROM_HEADS:
+            return "growFromHeads";
+        case TESSELLATE_STROKES:
+            return "tessellateStrokes";
+    }
+    return "unknown";
+}
+
+bool TracerPool::parsePipeline(std::string const& text, Pipeline& pipeline) {
+    Pipeline parsed;
+    for (auto const& name : ofSplitString(text, ",", true, true)) {
+        int pass = SET_HEADS_TO_ZERO;
+        while (pass <= TESSELLATE_STROKES && getPassName((Pass)pass) != name) {
+            pass++;
+        }
+        if (pass > TESSELLATE_STROKES) {
+            return false;
+        }
+        parsed.push_back((Pass)pass);
+    }
+    pipeline = parsed;
+    return true;
+}
+
+void TracerPool::setPipeline(Pipeline const& pipeline) {
+    this->pipeline = pipeline;
+    Pipeline withoutBox = getDefaultPipeline();
+    withoutBox.erase(std::find(withoutBox.begin(), withoutBox.end(), PROJECT_ONTO_BOX));
+    if (pipeline == getDefaultPipeline()) {
+        specialization = FUSED;
+    } else if (pipeline == withoutBox) {
+        specialization = FUSED_WITHOUT_BOX;
+    } else {
+        specialization = PASS_BY_PASS;
+    }
+}
+
+bool TracerPool::isPipelineFused() const {
+    return specialization != PASS_BY_PASS;
+}
+
+void TracerPool::update(Frame const& frame, JobSystem& jobs) {
+    sparks.clear();
+    if (specialization != PASS_BY_PASS && !isInteracting(frame) && !displaced) {
+        jobs.parallelFor(size(), TRACERS_PER_JOB, [&](size_t begin, size_t end) {
+            Profiler::Scope scope(profiler, Profiler::TRACER_JOB);
+            updateRange(frame, begin, end);
+        });
+        return;
+    }
+
+    // INTERACT needs every head moved first, so the passes either side of
+    // it run as separate sweeps.
+    auto first = pipeline.cbegin();
+    for (;;) {
+        auto const last = std::find(first, pipeline.cend(), INTERACT);
+        if (first != last) {
+            jobs.parallelFor(size(), TRACERS_PER_JOB, [&](size_t begin, size_t end) {
+                Profiler::Scope scope(profiler, Profiler::TRACER_JOB);
+                for (auto pass = first; pass != last; ++pass) {
+                    runPass(*pass, frame, begin, end);
+                }
+            });
+        }
+        if (last == pipeline.cend()) {
+            break;
+        }
+        interact(frame, &jobs);
+        first = last + 1;
+    }
+}
+
+void TracerPool::updateFromHeads(Frame const& frame, ofVec3f const* heads, size_t count, JobSystem& jobs) {
+    sparks.clear();
+    while (size() < count) {
+        spawn(heads[size()], ofVec3f(0, 0, 0), ofVec3f(0, 0, 0));
+    }
+    while (size() > count) {
+        despawn();
+    }
+    std::copy(heads, heads + count, this->heads.begin());
+    jobs.parallelFor(size(), TRACERS_PER_JOB, [&](size_t begin, size_t end) {
+        Profiler::Scope scope(profiler, Profiler::TRACER_JOB);
+        limitLength(frame, begin, end);
+        growFromHeads(begin, end);
+        tessellateStrokes(frame, begin, end);
+    });
+}
+
+ofVec3f const* TracerPool::getHeads() const {
+    return heads.data();
+}
+
+void TracerPool::setProfiler(Profiler* profiler) {
+    this->profiler = profiler;
+}
+
+void TracerPool::updateRange(Frame const& frame, size_t begin, size_t end) {
+    // Projecting onto a flat box is a no-op, so skip it in the loop too.
+    if (specialization == FUSED && hasBox(frame.boxSize * 0.5)) {
+        updateFused<true>(frame, begin, end);
+    } else {
+        updateFused<false>(frame, begin, end);
+    }
+}
+
+template <bool project>
+void TracerPool::updateFused(Frame const& frame, size_t begin, size_t end) {
+    static_assert(sizeof(ofVec3f) == 3 * sizeof(float), "ofVec3f must be packed");
+    float const low[3] = {frame.rangeX[0], frame.rangeY[0], frame.rangeZ[0]};
+    float const span[3] = {frame.rangeX[1] - frame.rangeX[0], frame.rangeY[1] - frame.rangeY[0], frame.rangeZ[1] - frame.rangeZ[0]};
+    ofVec3f const halfSize = frame.boxSize * 0.5;
+    int const keep = getKeep(frame.maxPoints, history.getCapacity());
+    int const farKeep = getKeep(std::min(frame.farMaxPoints, frame.maxPoints), history.getCapacity());
+    float t[3 * NOISE_BATCH_SIZE];
+    float noise[3 * NOISE_BATCH_SIZE];
+    uint64_t segments = 0;
+    for (size_t batch = begin; batch < end; batch += NOISE_BATCH_SIZE) {
+        size_t const tracers = std::min(end, batch + NOISE_BATCH_SIZE) - batch;
+        float const* velocity = &velocities[batch].x;
+        float const* timeShift = &timeShifts[batch].x;
+        for (size_t i = 0; i < 3 * tracers; i++) {
+            t[i] = velocity[i] * frame.time + timeShift[i];
+        }
+        BatchNoise::noise(t, noise, 3 * tracers);
+        for (size_t i = 0; i < tracers; i++) {
+            size_t const tracer = batch + i;
+            // Heads start from zero each frame, so the noise is the head.
+            ofVec3f head(noise[3 * i] * span[0] + low[0], noise[3 * i + 1] * span[1] + low[1], noise[3 * i + 2] * span[2] + low[2]);
+            if (project) {
+                ::projectOntoBox(head, halfSize);
+            }
+            heads[tracer] = head;
+            history.trim(tracer, head.dot(frame.viewNormal) < 0 ? farKeep : keep);
+            history.push(tracer, head);
+            segments += strokeCaches[tracer].update(history, tracer, frame.curveResolution, frame.maxPoints);
+        }
+    }
+    segmentsTessellated += segments;
+}
+
+void TracerPool::runPass(Pass pass, Frame const& frame) {
+    runPass(pass, frame, 0, size());
+}
+
+void TracerPool::runPass(Pass pass, Frame const& frame, size_t begin, size_t end) {
+    switch (pass) {
+        case SET_HEADS_TO_ZERO:
+            setHeadsToZero(begin, end);
+            break;
+        case MOVE_WITH_PERLIN_NOISE:
+            moveWithPerlinNoise(frame, begin, end);
+            break;
+        case INTERACT:
+            interact(frame, nullptr);
+            break;
+        case PROJECT_ONTO_BOX:
+            projectOntoBox(frame, begin, end);
+            break;
+        case LIMIT_LENGTH:
+            limitLength(frame, begin, end);
+            break;
+        case GROW_FROM_HEADS:
+            growFromHeads(begin, end);
+            break;
+        case TESSELLATE_STROKES:
+            tessellateStrokes(frame, begin, end);
+            break;
+    }
+}
+
+void TracerPool::setHeadsToZero(size_t begin, size_t end) {
+    std::fill(heads.begin() + begin, heads.begin() + end, ofVec3f(0, 0, 0));
+}
+
+void TracerPool::moveWithPerlinNoise(Frame const& frame, size_t begin, size_t end) {
+    // ofVec3f is three packed floats, so each field array is also a flat
+    // x, y, z, x, y, z... float array the noise kernel can sweep in one go.
+    static_assert(sizeof(ofVec3f) == 3 * sizeof(float), "ofVec3f must be packed");
+    float const low[3] = {frame.rangeX[0], frame.rangeY[0], frame.rangeZ[0]};
+    float const span[3] = {frame.rangeX[1] - frame.rangeX[0], frame.rangeY[1] - frame.rangeY[0], frame.rangeZ[1] - frame.rangeZ[0]};
+    float t[3 * NOISE_BATCH_SIZE];
+    float noise[3 * NOISE_BATCH_SIZE];
+    for (size_t batch = begin; batch < end; batch += NOISE_BATCH_SIZE) {
+        size_t const n = 3 * (std::min(end, batch + NOISE_BATCH_SIZE) - batch);
+        float const* velocity = &velocities[batch].x;
+        float const* timeShift = &timeShifts[batch].x;
+        float* head = &heads[batch].x;
+        for (size_t i = 0; i < n; i++) {
+            t[i] = velocity[i] * frame.time + timeShift[i];
+        }
+        BatchNoise::noise(t, noise, n);
+        for (size_t i = 0; i < n; i++) {
+            head[i] += noise[i] * span[i % 3] + low[i % 3];
+        }
+    }
+}
+
+void TracerPool::interact(Frame const& frame, JobSystem* jobs) {
+    if (!isInteracting(frame)) {
+        settleDisplacements();
+        return;
+    }
+
+    Profiler::Scope scope(profiler, Profiler::INTERACTION);
+    displaced = true;
+    for (size_t i = 0; i < count; i++) {
+        interactionPositions[i] = heads[i] + displacements[i];
+    }
+    grid.build(interactionPositions.data(), count, frame.interactionRadius);
+    size_t const ranges = std::max<size_t>(1, (count + TRACERS_PER_JOB - 1) / TRACERS_PER_JOB);
+    if (rangeSparks.size() < ranges) {
+        rangeSparks.resize(ranges);
+    }
+    // Without workers, or without jobs, one call covers every range.
+    for (size_t range = 0; range < ranges; range++) {
+        rangeSparks[range].clear();
+    }
+    if (jobs != nullptr) {
+        jobs->parallelFor(count, TRACERS_PER_JOB, [&](size_t begin, size_t end) {
+            interactRange(frame, begin, end);
+        });
+    } else {
+        interactRange(frame, 0, count);
+    }
+    // Gathered in range order, so offline renders stay repeatable however
+    // the ranges were scheduled.
+    for (size_t range = 0; range < ranges; range++) {
+        sparks.insert(sparks.end(), rangeSparks[range].begin(), rangeSparks[range].end());
+    }
+}
+
+void TracerPool::settleDisplacements() {
+    if (!displaced) {
+        return;
+    }
+
+    // Keep decaying as if interacting, so trails ease back onto their noise
+    // paths rather than snap to them.
+    float largest = 0;
+    for (size_t i = 0; i < count; i++) {
+        displacements[i] *= DISPLACEMENT_DECAY;
+        heads[i] += displacements[i];
+        largest = std::max(largest, displacements[i].lengthSquared());
+    }
+    if (largest < SETTLED_DISPLACEMENT * SETTLED_DISPLACEMENT) {
+        std::fill(displacements.begin(), displacements.begin() + count, ofVec3f(0, 0, 0));
+        displaced = false;
+    }
+}
+
+void TracerPool::interactRange(Frame const& frame, size_t begin, size_t end) {
+    // Only interactionPositions and the histories are shared; each tracer
+    // writes nothing but its own head and displacement.
+    float const radius = frame.interactionRadius;
+    float const sparkDistanceSquared = frame.sparkDistance * frame.sparkDistance;
+    auto const getFrom = [&](size_t tracer) {
+        return history.size(tracer) > 0 ? history.newest(tracer) : interactionPositions[tracer];
+    };
+    // Ranges are TRACERS_PER_JOB apart, or a single one from zero.
+    auto& found = rangeSparks[begin / TRACERS_PER_JOB];
+    for (size_t i = begin; i < end; i++) {
+        ofVec3f const position = interactionPositions[i];
+        ofVec3f const from = getFrom(i);
+        ofVec3f push(0, 0, 0);
+        ofVec3f motion(0, 0, 0);
+        int neighbors = 0;
+        grid.forEachNear(position, [&](uint32_t j) {
+            ofVec3f const away = position - interactionPositions[j];
+            float const distanceSquared = away.lengthSquared();
+            if (j == i || distanceSquared >= radius * radius) {
+                return;
+            }
+            float const distance = std::sqrt(distanceSquared);
+            if (distance > 0) {
+                push += away * ((radius - distance) / distance);
+            }
+            ofVec3f const otherFrom = getFrom(j);
+            motion += interactionPositions[j] - otherFrom;
+            neighbors++;
+            // Each pair is seen from both sides; only the lower index reports it.
+            ofVec3f crossing;
+            if (sparkDistanceSquared > 0 && j > i && getSegmentDistanceSquared(from, position, otherFrom, interactionPositions[j], crossing) < sparkDistanceSquared) {
+                found.push_back(crossing);
+            }
+        });
+
+        ofVec3f displacement = displacements[i] + push * (frame.repulsion * REPULSION_STEP);
+        if (neighbors > 0) {
+            displacement += (motion / neighbors - (position - from)) * frame.flocking;
+        }
+        displacements[i] = displacement * DISPLACEMENT_DECAY;
+        heads[i] += displacements[i];
+    }
+}
+
+void TracerPool::projectOntoBox(Frame const& frame, size_t begin, size_t end) {
+    ofVec3f const halfSize = frame.boxSize * 0.5;
+    if (!hasBox(halfSize)) {
+        return;
+    }
+
+    for (size_t i = begin; i < end; i++) {
+        ::projectOntoBox(heads[i], halfSize);
+    }
+}
+
+void TracerPool::limitLength(Frame const& frame, size_t begin, size_t end) {
+    // Leave room for the head that growFromHeads() is about to append.
+    int const keep = getKeep(frame.maxPoints, history.getCapacity());
+    int const farKeep = getKeep(std::min(frame.farMaxPoints, frame.maxPoints), history.getCapacity());
+    for (size_t i = begin; i < end; i++) {
+        history.trim(i, heads[i].dot(frame.viewNormal) < 0 ? farKeep : keep);
+    }
+}
+
+void TracerPool::growFromHeads(size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        history.push(i, heads[i]);
+    }
+}
+
+void TracerPool::tessellateStrokes(Frame const& frame, size_t begin, size_t end) {
+    uint64_t segments = 0;
+    for (size_t i = begin; i < end; i++) {
+        segments += strokeCaches[i].update(history, i, frame.curveResolution, frame.maxPoints);
+    }
+    segmentsTessellated += segments;
+}
+
+void TracerPool::invalidateStrokes() {
+    for (auto& cache : strokeCaches) {
+        cache.invalidate();
+    }
+}
+
+void TracerPool::vibrateMultiplierShifts(Style const& style) {
+    int const copies = ofClamp(style.multiplierCount, 0, MAX_MULTIPLIER_COUNT);
+    for (size_t i = 0; i < count; i++) {
+        auto first = multiplierShifts.begin() + i * MAX_MULTIPLIER_COUNT;
+        for (auto shift = first; shift != first + copies; ++shift) {
+            bool const unset = shift->x == 0 && shift->y == 0 && shift->z == 0;
+            if (unset || ofRandom(1) < style.entropy) {
+                *shift = ofVec3f(ofRandom(-style.maxShift, style.maxShift), ofRandom(-style.maxShift, style.maxShift), ofRandom(-style.maxShift, style.maxShift));
+            }
+        }
+    }
+}
+
+void TracerPool::buildStrokes(Style const& style, std::vector<StrokeMesh::Instanced>& strokes) {
+    vibrateMultiplierShifts(style);
+
+    size_t const copies = ofClamp(style.multiplierCount, 0, MAX_MULTIPLIER_COUNT);
+    strokes.resize(count);
+    size_t vertices = 0;
+    for (size_t i = 0; i < count; i++) {
+        auto& mesh = strokes[i].mesh;
+        mesh.getVertices().clear();
+        mesh.getNormals().clear();
+        mesh.getTexCoords().clear();
+        mesh.getIndices().clear();
+        strokeCaches[i].appendTo(mesh);
+        if (vertices + mesh.getVertices().size() > MAX_STROKE_VERTICES) {
+            mesh.getVertices().clear();
+            mesh.getNormals().clear();
+            mesh.getTexCoords().clear();
+            mesh.getIndices().clear();
+            strokeStats.droppedStrokes++;
+        }
+        vertices += mesh.getVertices().size();
+
+        auto& offsets = strokes[i].offsets;
+        auto const first = multiplierShifts.begin() + i * MAX_MULTIPLIER_COUNT;
+        offsets.assign(1, ofVec3f(0, 0, 0));
+        offsets.insert(offsets.end(), first, first + copies);
+    }
+    strokeStats.vertexBytes += vertices * StrokeMesh::bytesPerVertex();
+}
+
+void TracerPool::buildStrokes(Style const& style) {
+    buildStrokes(style, strokes);
+}
+
+void TracerPool::buildPaths(Style const& style, std::vector<ofPolyline>& paths, std::vector<ofVec3f>& offsets) {
+    vibrateMultiplierShifts(style);
+
+    size_t const copies = ofClamp(style.multiplierCount, 0, MAX_MULTIPLIER_COUNT);
+    paths.resize(count);
+    offsets.clear();
+    for (size_t i = 0; i < count; i++) {
+        paths[i].clear();
+        strokeCaches[i].appendCenterline(paths[i]);
+        auto const first = multiplierShifts.begin() + i * MAX_MULTIPLIER_COUNT;
+        offsets.insert(offsets.end(), first, first + copies);
+    }
+}
+
+std::vector<ofVec3f> const& TracerPool::getSparks() const {
+    return sparks;
+}
+
+StrokeMesh::Stats TracerPool::getStrokeStats() const {
+    auto stats = strokeStats;
+    stats.segments = segmentsTessellated;
+    return stats;
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "ofMain.h"
+#include "JobSystem.h"
+#include "PointHistory.h"
+#include "Profiler.h"
+#include "SpatialHash.h"
+#include "StrokeCache.h"
+#include "StrokeMesh.h"
+#include <atomic>
+
+// Every tracer's state lives in per-field arrays indexed by tracer. Each
+// behavior from the old per-tracer chain runs as one pass over all tracers.
+// Despawning keeps a tracer's slot, point history and stroke buffers for
+// the next spawn, so once the pool has reached a tracer count, moving
+// between counts below it never touches the allocator.
+class TracerPool {
+public:
+    // Property values a frame of update behaviors reads. Built once per frame
+    // on the main thread so workers never read a property mid-change. The
+    // defaults only cover a tick that runs before the app's first frame.
+    struct Frame {
+        float time = 0;
+        ofVec2f rangeX;
+        ofVec2f rangeY;
+        ofVec2f rangeZ;
+        ofVec3f boxSize;
+        int maxPoints = 100;
+        // Tracers on the far side of the box center, seen along viewNormal,
+        // keep only farMaxPoints.
+        int farMaxPoints = 100;
+        ofVec3f viewNormal = ofVec3f(0, 0, 1);
+        int curveResolution = StrokeCache::MAX_RESOLUTION;
+        // Tracers within interactionRadius of each other push apart by
+        // repulsion and match each other's motion by flocking.
+        float repulsion = 0;
+        float flocking = 0;
+        float interactionRadius = 30;
+        // Two tracers whose latest moves pass closer than this make a
+        // spark; 0 turns sparks off.
+        float sparkDistance = 0;
+    };
+
+    // Property values a frame of draw behaviors reads.
+    struct Style {
+        ofColor strokeColor;
+        float strokeWidth = 1;
+        int multiplierCount = 0;
+        float maxShift = 0;
+        float entropy = 0;
+        // Direction towards the viewer in tracer space.
+        ofVec3f viewNormal = ofVec3f(0, 0, 1);
+    };
+
+    // The update behaviors, in the order update() runs them.
+    enum Pass {
+        SET_HEADS_TO_ZERO,
+        MOVE_WITH_PERLIN_NOISE,
+        PROJECT_ONTO_BOX,
+        // Reads every tracer's head, so it always covers the whole pool.
+        INTERACT,
+        LIMIT_LENGTH,
+        GROW_FROM_HEADS,
+        TESSELLATE_STROKES
+    };
+    // Passes in the order update() runs them. The default chain, with or
+    // without PROJECT_ONTO_BOX, runs as one loop compiled for that chain
+    // while no tracers interact or are still easing back from interacting;
+    // any other chain runs pass by pass.
+    typedef std::vector<Pass> Pipeline;
+    static Pipeline getDefaultPipeline();
+    // Pass names as in the method names, e.g. "setHeadsToZero".
+    static std::string getPassName(Pass pass);
+    // Reads comma-separated pass names. False, leaving pipeline alone, on
+    // any name it does not know.
+    static bool parsePipeline(std::string const& text, Pipeline& pipeline);
+
+    TracerPool(int maxPointsCapacity);
+
+    // Allocates slots for tracers up front, so spawning up to that many never allocates.
+    void reserve(size_t tracers);
+    void spawn(ofVec3f const& head, ofVec3f const& timeShift, ofVec3f const& velocity);
+    void despawn();
+    size_t size() const;
+    // Slots allocated, live or not.
+    size_t getCapacity() const;
+    void setVelocity(ofVec3f const& velocity);
+    PointSpans getPoints(size_t tracer) const;
+
+    void setPipeline(Pipeline const& pipeline);
+    // Whether the pipeline runs as a compiled chain.
+    bool isPipelineFused() const;
+    void update(Frame const& frame, JobSystem& jobs);
+    // For render nodes: takes the first count heads from elsewhere instead
+    // of moving them, then trims, grows and tessellates as update() would.
+    // Only maxPoints, farMaxPoints, viewNormal and curveResolution are read.
+    void updateFromHeads(Frame const& frame, ofVec3f const* heads, size_t count, JobSystem& jobs);
+    // Every live tracer's head after the last update.
+    ofVec3f const* getHeads() const;
+    // Runs one behavior over every tracer on the calling thread, so it can
+    // be measured on its own.
+    void runPass(Pass pass, Frame const& frame);
+    // Times each worker range as Profiler::TRACER_JOB; null stops timing.
+    void setProfiler(Profiler* profiler);
+    // Copies each tracer's cached stroke once, with the offsets of its
+    // multiplier copies, for StrokeMesh::drawInstanced().
+    void buildStrokes(Style const& style, std::vector<StrokeMesh::Instanced>& strokes);
+    // Into strokes of the pool's own, for measuring.
+    void buildStrokes(Style const& style);
+    // The same curves as one path per tracer, and style.multiplierCount
+    // offsets per tracer for its copies, for the path stroke backends.
+    void buildPaths(Style const& style, std::vector<ofPolyline>& paths, std::vector<ofVec3f>& offsets);
+    StrokeMesh::Stats getStrokeStats() const;
+    // Where the latest moves of two tracers crossed during the last update().
+    std::vector<ofVec3f> const& getSparks() const;
+    // Forces every stroke to be tessellated again on the next update.
+    void invalidateStrokes();
+
+private:
+    enum Specialization {
+        FUSED,
+        FUSED_WITHOUT_BOX,
+        PASS_BY_PASS
+    };
+
+    // Update behaviors, each over tracers [begin, end)
+    void updateRange(Frame const& frame, size_t begin, size_t end);
+    void interact(Frame const& frame, JobSystem* jobs);
+    void interactRange(Frame const& frame, size_t begin, size_t end);
+    // The interact pass while tracers do not interact.
+    void settleDisplacements();
+    // The whole default chain in one sweep: each tracer moves, lands on the
+    // box, grows and tessellates while its data is still in cache.
+    template <bool project> void updateFused(Frame const& frame, size_t begin, size_t end);
+    void runPass(Pass pass, Frame const& frame, size_t begin, size_t end);
+    void setHeadsToZero(size_t begin, size_t end);
+    void moveWithPerlinNoise(Frame const& frame, size_t begin, size_t end);
+    void projectOntoBox(Frame const& frame, size_t begin, size_t end);
+    void limitLength(Frame const& frame, size_t begin, size_t end);
+    void growFromHeads(size_t begin, size_t end);
+    void tessellateStrokes(Frame const& frame, size_t begin, size_t end);
+
+    // Draw behaviors
+    void vibrateMultiplierShifts(Style const& style);
+
+    void addSlot();
+
+    size_t const TRACERS_PER_JOB = 16;
+    static size_t const NOISE_BATCH_SIZE = 64;
+    int const MAX_MULTIPLIER_COUNT = 255;
+    // A build leaves out strokes past this many vertices, about 128 MB at
+    // 32 bytes each. 127 trails of 1000 points at the finest curve
+    // resolution need about 2.3M.
+    size_t const MAX_STROKE_VERTICES = 1 << 22;
+    // Of a full overlap, the push apart each frame at repulsion 1.
+    float const REPULSION_STEP = 0.1;
+    // Displacement left each frame, so tracers drift back to their noise
+    // paths once apart.
+    float const DISPLACEMENT_DECAY = 0.95;
+    // Below this, in every tracer, displacements are dropped and update()
+    // can fuse again.
+    float const SETTLED_DISPLACEMENT = 0.01;
+
+    Pipeline pipeline = getDefaultPipeline();
+    Specialization specialization = FUSED;
+
+    // Live tracers are slots [0, count).
+    size_t count = 0;
+    std::vector<ofVec3f> heads;
+    std::vector<ofVec3f> velocities;
+    std::vector<ofVec3f> timeShifts;
+    // Offsets from the noise path that interaction has built up.
+    std::vector<ofVec3f> displacements;
+    // Whether any displacement is left to decay.
+    bool displaced = false;
+    // Where each tracer is this frame before interacting, which neighbors read.
+    std::vector<ofVec3f> interactionPositions;
+    SpatialHash grid;
+    std::vector<ofVec3f> sparks;
+    // Sparks each worker range of interact() found, kept between frames.
+    std::vector<std::vector<ofVec3f>> rangeSparks;
+    PointHistory history;
+    std::vector<ofVec3f> multiplierShifts;
+    std::vector<StrokeCache> strokeCaches;
+    std::atomic<uint64_t> segmentsTessellated = {0};
+    std::vector<StrokeMesh::Instanced> strokes;
+    StrokeMesh::Stats strokeStats;
+    Profiler* profiler = nullptr;
+};
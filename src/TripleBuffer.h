@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+
+// Hands whole values from one writer thread to one reader thread without
+// either waiting. The writer fills its back buffer and publishes it; the
+// reader takes the newest published buffer and keeps it until it asks
+// again, so what it holds never changes underneath it. A publish the
+// reader never saw is simply replaced by the next one.
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer side.
+    T& getBack() {
+        return buffers[back];
+    }
+
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader side: the newest published value, or the one held before if
+    // nothing new was published.
+    T const& acquire() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & INDEX;
+        }
+        return buffers[front];
+    }
+
+private:
+    static int const INDEX = 3;
+    static int const FRESH = 4;
+
+    T buffers[3];
+    int back = 0;
+    std::atomic<int> middle = {1};
+    int front = 2;
+};
@@ -0,0 +1,144 @@
+#include "TweenPool.h"
+#include <climits>
+
+TweenPool::TweenPool(int capacity) : capacity(capacity), maxGenerations(INT_MAX / capacity) {
+    ids.reserve(capacity);
+    targets.reserve(capacity);
+    shapes.reserve(capacity);
+    froms.reserve(capacity);
+    spans.reserve(capacity);
+    starts.reserve(capacity);
+    periods.reserve(capacity);
+    cycles.reserve(capacity);
+    values.reserve(capacity);
+    finished.reserve(capacity);
+    slots.assign(capacity, -1);
+    generations.assign(capacity, 0);
+    freeSlots.reserve(capacity);
+    for (int slot = capacity - 1; slot >= 0; slot--) {
+        freeSlots.push_back(slot);
+    }
+}
+
+TweenPool::Id TweenPool::start(Tween const& tween, double beat) {
+    if (freeSlots.empty() || tween.target == PropertyGraph::INVALID_HANDLE) {
+        return INVALID_ID;
+    }
+
+    int const slot = freeSlots.back();
+    freeSlots.pop_back();
+    Id const id = generations[slot] * capacity + slot;
+    slots[slot] = ids.size();
+    double const period = std::max(tween.periodBeats, 1e-3);
+    ids.push_back(id);
+    targets.push_back(tween.target);
+    shapes.push_back(tween.shape);
+    froms.push_back(tween.from);
+    spans.push_back(tween.to - tween.from);
+    starts.push_back(beat - tween.phase * period);
+    periods.push_back(period);
+    cycles.push_back(std::max(tween.cycles, 0));
+    values.push_back(tween.from);
+    finished.push_back(0);
+    return id;
+}
+
+void TweenPool::stop(Id id) {
+    if (isActive(id)) {
+        remove(slots[getSlot(id)]);
+    }
+}
+
+void TweenPool::stopAll() {
+    while (!ids.empty()) {
+        remove(ids.size() - 1);
+    }
+}
+
+bool TweenPool::isActive(Id id) const {
+    if (id < 0) {
+        return false;
+    }
+    int const slot = getSlot(id);
+    return slots[slot] >= 0 && ids[slots[slot]] == id;
+}
+
+size_t TweenPool::size() const {
+    return ids.size();
+}
+
+int TweenPool::getCapacity() const {
+    return capacity;
+}
+
+int TweenPool::getSlot(Id id) const {
+    return id % capacity;
+}
+
+void TweenPool::remove(size_t index) {
+    // Swap the last tween into the hole to keep the arrays dense.
+    size_t const last = ids.size() - 1;
+    int const slot = getSlot(ids[index]);
+    slots[slot] = -1;
+    generations[slot] = (generations[slot] + 1) % maxGenerations;
+    freeSlots.push_back(slot);
+    if (index != last) {
+        ids[index] = ids[last];
+        targets[index] = targets[last];
+        shapes[index] = shapes[last];
+        froms[index] = froms[last];
+        spans[index] = spans[last];
+        starts[index] = starts[last];
+        periods[index] = periods[last];
+        cycles[index] = cycles[last];
+        values[index] = values[last];
+        finished[index] = finished[last];
+        slots[getSlot(ids[index])] = index;
+    }
+    ids.pop_back();
+    targets.pop_back();
+    shapes.pop_back();
+    froms.pop_back();
+    spans.pop_back();
+    starts.pop_back();
+    periods.pop_back();
+    cycles.pop_back();
+    values.pop_back();
+    finished.pop_back();
+}
+
+void TweenPool::update(double beat, PropertyGraph& graph) {
+    size_t const count = ids.size();
+    for (size_t i = 0; i < count; i++) {
+        double const t = std::max((beat - starts[i]) / periods[i], 0.0);
+        finished[i] = cycles[i] > 0 && t >= cycles[i];
+        // A finished tween rests where its last cycle ends.
+        float const x = finished[i] ? 1 : t - std::floor(t);
+        float u = x;
+        switch (shapes[i]) {
+            case RAMP:
+                break;
+            case TRIANGLE:
+                u = 1 - std::abs(2 * x - 1);
+                break;
+            case SINE:
+                u = 0.5 - 0.5 * std::cos(TWO_PI * x);
+                break;
+            case SQUARE:
+                u = x < 0.5 ? 0 : 1;
+                break;
+        }
+        values[i] = froms[i] + spans[i] * u;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        graph.get(targets[i])->setScale(values[i]);
+    }
+    graph.markDirty(targets.data(), count);
+
+    for (size_t i = count; i-- > 0;) {
+        if (finished[i]) {
+            remove(i);
+        }
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "PropertyGraph.h"
+
+// Property modulation on the beat. Every active tween lives in the same
+// fixed-capacity field arrays, so starting, finishing and evaluating tweens
+// never allocates, and update() sweeps them all in one pass. Tweens drive a
+// property's scale, which works the same for property<int>, <float>,
+// <ofVec2f> and <ofVec3f>.
+class TweenPool {
+public:
+    // An id names one tween only: once it finishes or is stopped, its id
+    // stays inactive even after the pool reuses its slot.
+    typedef int Id;
+    static Id const INVALID_ID = -1;
+
+    enum Shape {
+        // from to to, then jump back when looping.
+        RAMP,
+        // from to to and back, linearly.
+        TRIANGLE,
+        // from to to and back, smoothly.
+        SINE,
+        // from for the first half, to for the second.
+        SQUARE
+    };
+
+    struct Tween {
+        PropertyGraph::Handle target = PropertyGraph::INVALID_HANDLE;
+        Shape shape = TRIANGLE;
+        float from = 0;
+        float to = 1;
+        double periodBeats = 4;
+        // Where in the cycle to begin, 0 to 1.
+        float phase = 0;
+        // 0 repeats until stopped.
+        int cycles = 0;
+    };
+
+    TweenPool(int capacity = 4096);
+
+    // Returns INVALID_ID when the pool is full.
+    Id start(Tween const& tween, double beat);
+    void stop(Id id);
+    void stopAll();
+    bool isActive(Id id) const;
+    size_t size() const;
+    int getCapacity() const;
+
+    // Sets every target's scale for the given beat, marks the targets dirty
+    // and retires finished tweens.
+    void update(double beat, PropertyGraph& graph);
+
+private:
+    void remove(size_t index);
+    // Ids are generation * capacity + slot.
+    int getSlot(Id id) const;
+
+    int const capacity;
+    // Generations wrap before generation * capacity overflows an Id.
+    int const maxGenerations;
+    // Dense, one entry per active tween.
+    std::vector<Id> ids;
+    std::vector<PropertyGraph::Handle> targets;
+    std::vector<uint8_t> shapes;
+    std::vector<float> froms;
+    std::vector<float> spans;
+    std::vector<double> starts;
+    std::vector<double> periods;
+    std::vector<int> cycles;
+    std::vector<float> values;
+    std::vector<uint8_t> finished;
+    // Slot to dense index, or -1.
+    std::vector<int> slots;
+    // Bumped whenever a slot's tween is removed, so its old id goes stale.
+    std::vector<int> generations;
+    std::vector<int> freeSlots;
+};
@@ -0,0 +1,103 @@
+#include "V4l2VideoOutput.h"
+
+#ifdef TARGET_LINUX
+
+#include <cstring>
+#include <fcntl.h>
+#include <linux/videodev2.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+V4l2VideoOutput::V4l2VideoOutput(std::string const& device) : device(device) {
+    fd = ::open(device.c_str(), O_WRONLY);
+    if (fd < 0) {
+        ofLogError("V4l2VideoOutput") << "open " << device << ": " << strerror(errno);
+        return;
+    }
+    writer = std::thread(&V4l2VideoOutput::writeLoop, this);
+}
+
+V4l2VideoOutput::~V4l2VideoOutput() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frameReady.notify_one();
+    if (writer.joinable()) {
+        writer.join();
+    }
+    readback.release();
+    if (fd >= 0) {
+        ::close(fd);
+    }
+}
+
+bool V4l2VideoOutput::configure(int width, int height) {
+    v4l2_format format;
+    memset(&format, 0, sizeof(format));
+    format.type = V4L2_BUF_TYPE_VIDEO_OUTPUT;
+    format.fmt.pix.width = width;
+    format.fmt.pix.height = height;
+    // B, G, R, A bytes, which glReadPixels gives for GL_BGRA.
+    format.fmt.pix.pixelformat = V4L2_PIX_FMT_BGR32;
+    format.fmt.pix.field = V4L2_FIELD_NONE;
+    format.fmt.pix.bytesperline = width * 4;
+    format.fmt.pix.sizeimage = width * height * 4;
+    format.fmt.pix.colorspace = V4L2_COLORSPACE_SRGB;
+    if (ioctl(fd, VIDIOC_S_FMT, &format) < 0) {
+        ofLogError("V4l2VideoOutput") << "VIDIOC_S_FMT " << width << "x" << height << " on " << device << ": " << strerror(errno);
+        return false;
+    }
+    this->width = width;
+    this->height = height;
+    return true;
+}
+
+void V4l2VideoOutput::publishScreen(int width, int height) {
+    if (fd < 0) {
+        return;
+    }
+
+    auto const pixels = readback.read(width, height, GL_BGRA);
+    if (pixels.data == nullptr) {
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if ((pixels.width != this->width || pixels.height != this->height) && !configure(pixels.width, pixels.height)) {
+        lock.unlock();
+        readback.release();
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    // Video devices want the top row first.
+    size_t const stride = pixels.width * 4;
+    latest.resize(stride * pixels.height);
+    for (int row = 0; row < pixels.height; row++) {
+        memcpy(&latest[row * stride], pixels.data + (pixels.height - 1 - row) * stride, stride);
+    }
+    hasFrame = true;
+    lock.unlock();
+    readback.release();
+    frameReady.notify_one();
+}
+
+void V4l2VideoOutput::writeLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    for (;;) {
+        frameReady.wait(lock, [&]() { return stopping || hasFrame; });
+        if (stopping) {
+            return;
+        }
+        latest.swap(writing);
+        hasFrame = false;
+        lock.unlock();
+        if (write(fd, writing.data(), writing.size()) < 0 && errno != EAGAIN) {
+            ofLogWarning("V4l2VideoOutput") << "write to " << device << ": " << strerror(errno);
+        }
+        lock.lock();
+    }
+}
+
+#endif
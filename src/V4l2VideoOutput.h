@@ -0,0 +1,39 @@
+#pragma once
+
+#ifdef TARGET_LINUX
+
+#include "VideoOutput.h"
+#include "PixelReadback.h"
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Writes frames to a v4l2loopback device, so anything that reads a webcam
+// can read Tracer. write() runs on its own thread and only ever gets the
+// newest frame; frames it is too slow for are skipped.
+class V4l2VideoOutput : public VideoOutput {
+public:
+    V4l2VideoOutput(std::string const& device);
+    ~V4l2VideoOutput();
+    void publishScreen(int width, int height) override;
+
+private:
+    bool configure(int width, int height);
+    void writeLoop();
+
+    std::string const device;
+    int fd = -1;
+    int width = 0;
+    int height = 0;
+    PixelReadback readback;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable frameReady;
+    std::vector<unsigned char> latest;
+    std::vector<unsigned char> writing;
+    bool hasFrame = false;
+    bool stopping = false;
+};
+
+#endif
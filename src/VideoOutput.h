@@ -0,0 +1,11 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Somewhere each finished frame is sent for other programs to use.
+class VideoOutput {
+public:
+    virtual ~VideoOutput() {}
+    // Main thread, after drawing, while the frame is in the bound framebuffer.
+    virtual void publishScreen(int width, int height) = 0;
+};
@@ -1,13 +1,63 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "Benchmark.h"
+#include "OfflineRender.h"
+#include "SessionLog.h"
+#include "StreamOptions.h"
 
 //========================================================================
-int main( ){
+int main(int argc, char* argv[]){
+	if (argc == 3 && std::string(argv[1]) == "--analyze-wav") {
+		return AudioAnalyzer::analyzeFile(argv[2]);
+	}
+	if (argc == 2 && std::string(argv[1]) == "--bench-multiplier") {
+		return Benchmark::runMultiplier();
+	}
+	if (argc >= 2 && std::string(argv[1]) == "--bench") {
+		return Benchmark::runSuite(argc == 4 && std::string(argv[2]) == "--out" ? argv[3] : "");
+	}
+	if (argc == 2 && std::string(argv[1]) == "--bench-check") {
+		return Benchmark::runChecks();
+	}
+	if ((argc == 4 || argc == 5) && std::string(argv[1]) == "--bench-compare") {
+		return Benchmark::compare(argv[2], argv[3], argc == 5 ? atof(argv[4]) : 0.1);
+	}
+
+	if (argc == 3 && std::string(argv[1]) == "--dump-session") {
+		return SessionLog::dump(argv[2]);
+	}
+
+	// "--replay log" may come before any other options.
+	std::string replay;
+	if (argc >= 3 && std::string(argv[1]) == "--replay") {
+		replay = argv[2];
+		argv[2] = argv[0];
+		argc -= 2;
+		argv += 2;
+	}
+
+	// Then "--stream-to" or "--render-node", before any render options.
+	StreamOptions stream;
+	if (!StreamOptions::parse(argc, argv, stream)) {
+		return 1;
+	}
+
+	OfflineRender offline;
+	if (!OfflineRender::parse(argc, argv, offline)) {
+		return 1;
+	}
+
 	ofAppGLFWWindow window;
 	ofGLFWWindowSettings s;
 	s.width = 700;
 	s.height = 700;
 	s.stencilBits = 8;
+	if (offline.isEnabled()) {
+		// Frames go to an FBO, so the window only has to hold a GL context.
+		s.width = offline.width;
+		s.height = offline.height;
+		s.visible = false;
+	}
 	ofCreateWindow(s);
-	ofRunApp(new ofApp);
+	ofRunApp(new ofApp(offline, replay, stream));
 }
@@ -1,24 +1,193 @@
 #include "ofApp.h"
+#include "BatchNoise.h"
+
+ofApp::ofApp(OfflineRender const& offline, std::string const& replayPath, StreamOptions const& stream) : replayPath(replayPath), offline(offline), stream(stream) {
+}
 
 void ofApp::setup() {
-    time = ofGetElapsedTimeMillis();
+    setupOfflineRender();
+    time = clock.getElapsedTimeMillis();
     pizza.load("pizza.png");
-    setupSyphon();
     setupRenderer();
     setupOpenFrameworks();
     setupSoundStream();
     setupMidiFighterTwister();
     setupProperties();
+    setupPresets();
+    setupReplay();
+    setupVideoOutputs();
     setupTracers();
+    setupStream();
 }
 
 ofApp::~ofApp() {
-    savePropertiesToXml(ofApp::SETTINGS_FILE);
+    // An offline render only reads the settings so that reruns match, a
+    // render node only holds what the simulation node sent it, and a replay
+    // holds the logged show rather than this machine's settings.
+    if (!offline.isEnabled() && !isRenderNode() && !isReplaying()) {
+        savePropertiesToXml(ofApp::SETTINGS_FILE);
+    }
+}
+
+bool ofApp::isReplaying() const {
+    return !replayPath.empty();
+}
+
+void ofApp::setupReplay() {
+    if (!isReplaying()) {
+        return;
+    }
+
+    std::vector<std::string> names;
+    if (!SessionLog::load(replayPath, names, replayRecords)) {
+        std::cout << "Could not read " << replayPath << std::endl;
+        ofExit(1);
+        return;
+    }
+    for (auto const& name : names) {
+        replayHandles.push_back(propertyGraph.getHandle(name));
+    }
+    std::cout << "Replaying " << replayRecords.size() << " records from " << replayPath << std::endl;
+}
+
+void ofApp::replaySession() {
+    if (replayNext >= replayRecords.size()) {
+        return;
+    }
+
+    uint64_t const micros = clock.getElapsedTimeMicros();
+    if (replayNext == 0) {
+        replayStartMicros = micros;
+    }
+    uint64_t const logMicros = replayRecords.front().micros + (micros - replayStartMicros);
+    for (; replayNext < replayRecords.size() && replayRecords[replayNext].micros <= logMicros; replayNext++) {
+        auto const& record = replayRecords[replayNext];
+        switch (record.type) {
+            case SessionLog::PROPERTY_SNAPSHOT:
+                if (record.id < replayHandles.size() && replayHandles[record.id] != PropertyGraph::INVALID_HANDLE) {
+                    propertyGraph.get(replayHandles[record.id])->setScale(record.value);
+                    propertyGraph.markDirty(replayHandles[record.id]);
+                }
+                break;
+            case SessionLog::MIDI_ENCODER:
+            case SessionLog::MIDI_PUSH_SWITCH:
+            case SessionLog::MIDI_SIDE_BUTTON:
+                midiQueue.push((MidiQueue::Control)(record.type - SessionLog::MIDI_ENCODER), record.id, record.value, profiler.now());
+                break;
+            case SessionLog::KEY:
+                performKey(record.id);
+                break;
+            case SessionLog::AUDIO_VOLUME:
+                smoothedVol = record.value;
+                break;
+            case SessionLog::AUDIO_TEMPO:
+                tempo = record.value;
+                break;
+            case SessionLog::AUDIO_TEMPO_CONFIDENCE:
+                tempoConfidence = record.value;
+                break;
+            default:
+                break;
+        }
+    }
+
+    if (replayNext == replayRecords.size() && !offline.isEnabled()) {
+        std::cout << "Replay finished" << std::endl;
+        exportProfile("replay-profile");
+        ofExit(0);
+    }
+}
+
+void ofApp::updateSessionRecording() {
+    bool const wanted = recordSession && !offline.isEnabled() && !isReplaying() && !isRenderNode();
+    if (!wanted) {
+        if (sessionLog.isRecording()) {
+            sessionLog.stop();
+            std::cout << "Stopped session log, " << sessionLog.getDropped() << " records dropped" << std::endl;
+        }
+        return;
+    }
+    if (sessionLog.isRecording()) {
+        return;
+    }
+
+    ofDirectory::createDirectory(ofToDataPath("sessions"), false, true);
+    std::string const path = ofToDataPath("sessions/" + ofGetTimestampString() + ".trs");
+    std::vector<std::string> names;
+    for (size_t handle = 0; handle < propertyGraph.size(); handle++) {
+        names.push_back(propertyGraph.get(handle)->getName());
+    }
+    if (!sessionLog.start(path, names)) {
+        std::cout << "Could not write " << path << std::endl;
+        return;
+    }
+    sessionLog.beginFrame(clock.getElapsedTimeMicros(), ofGetFrameNum(), lastFrameMillis);
+    for (size_t i = 0; i < properties.size(); i++) {
+        sessionLog.append(SessionLog::PROPERTY_SNAPSHOT, propertyHandles[i], properties[i]->getScale());
+    }
+    for (auto property : engineProperties) {
+        sessionLog.append(SessionLog::PROPERTY_SNAPSHOT, propertyGraph.getHandle(property), property->getScale());
+    }
+    std::cout << "Logging session to " << path << std::endl;
+}
+
+void ofApp::setupVideoOutputs() {
+    if (offline.isEnabled()) {
+        return;
+    }
+
+    // Render nodes sharing a machine would otherwise unlink and overwrite
+    // each other's segment, or fight over one Syphon server.
+    std::string const node = stream.getNodeName();
+#ifdef TARGET_OSX
+    videoOutputs.emplace_back(new SyphonVideoOutput(node.empty() ? "Tracer" : "Tracer " + node));
+#else
+    videoOutputs.emplace_back(new SharedMemoryVideoOutput(node.empty() ? "tracer" : "tracer-" + node));
+#endif
+#ifdef TARGET_LINUX
+    if (v4l2Device >= 0) {
+        videoOutputs.emplace_back(new V4l2VideoOutput("/dev/video" + ofToString((int)v4l2Device)));
+    }
+#endif
+}
+
+void ofApp::setupOfflineRender() {
+    if (!offline.isEnabled()) {
+        return;
+    }
+
+    clock.setFixedStep(1.0 / offline.framesPerSecond);
+    ofSeedRandom(offline.seed);
+    // Offline there is no show to protect, so wait for the encoders instead of dropping.
+    recorder.start(ofToDataPath(offline.outputDirectory), FrameRecorder::PNG_SEQUENCE, false);
+    if (!offline.midiFile.empty() && !midiLog.load(ofToDataPath(offline.midiFile))) {
+        std::cout << "Could not read " << offline.midiFile << std::endl;
+        ofExit(1);
+    }
+
+    ofFbo::Settings settings;
+    settings.width = offline.width;
+    settings.height = offline.height;
+    settings.internalformat = GL_RGBA;
+    settings.useDepth = true;
+    settings.useStencil = true;
+    offlineTarget.allocate(settings);
+    offlineStart = std::chrono::steady_clock::now();
 }
 
-void ofApp::setupSyphon() {
-    mainOutputSyphonServer.setName("Tracer");
+void ofApp::finishOfflineFrame() {
+    if (++offlineFrame < offline.frames) {
+        return;
+    }
 
+    recorder.stop();
+    recorder.waitUntilWritten();
+    double const seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - offlineStart).count();
+    exportProfile(offline.outputDirectory + "/profile");
+    std::cout << "Rendered " << offlineFrame << " frames of " << offline.width << "x" << offline.height << " to " << offline.outputDirectory << " in " << seconds << " s (" << offlineFrame / seconds << " frames/sec)" << std::endl;
+    auto const strokes = profiler.getSummary(Profiler::DRAW);
+    std::cout << "Drew strokes with " << StrokeMesh::getBackendName((StrokeMesh::Backend)(int)strokeBackend) << " in " << strokes.p50Micros << " us per frame (p50), " << strokes.p99Micros << " us (p99)" << std::endl;
+    ofExit(0);
 }
 ofVec3f ofApp::getStageSize() {
     return ofVec3f(ofGetWidth(), ofGetHeight(), (ofGetWidth() + ofGetHeight()) / 2);
@@ -33,19 +202,97 @@ void ofApp::loadPropertiesFromXml(std::string& file) {
     
     for (auto property : properties) {
         property->load(settings);
+        propertyGraph.markDirty(property);
+    }
+    for (auto property : engineProperties) {
+        property->load(settings);
+        propertyGraph.markDirty(property);
     }
+
+    // e.g. <pipeline>setHeadsToZero,moveWithPerlinNoise,growFromHeads,tessellateStrokes</pipeline>
+    auto pipeline = TracerPool::getDefaultPipeline();
+    std::string const pipelineText = settings.getValue("pipeline", std::string());
+    if (!pipelineText.empty()) {
+        if (TracerPool::parsePipeline(pipelineText, pipeline)) {
+            std::cout << "Updating tracers with " << pipelineText << std::endl;
+        } else {
+            std::cout << "Unknown pass in pipeline " << pipelineText << ", updating with the default" << std::endl;
+        }
+    }
+    simulation.setPipeline(pipeline);
 }
 
 void ofApp::savePropertiesToXml(std::string& file) {
     for (auto property : properties) {
         property->save(settings);
     }
+    for (auto property : engineProperties) {
+        property->save(settings);
+    }
     
     settings.save(file);
 }
 
+void ofApp::setupPresets() {
+    // A replayed 's' stores into the bank so later recalls match the show,
+    // but must not overwrite the presets on this machine.
+    if (!presets.open(ofToDataPath(PRESETS_FILE), properties, !isReplaying())) {
+        return;
+    }
+    // Seed a new bank with the scene from settings.xml.
+    if (!offline.isEnabled() && !presets.has(activePreset)) {
+        storePreset(activePreset);
+    }
+}
+
+void ofApp::recallPreset(int preset, double beats) {
+    float const* scales = presets.get(preset);
+    if (scales == nullptr) {
+        std::cout << "Preset " << preset + 1 << " is empty" << std::endl;
+        return;
+    }
+
+    std::cout << "Recalling preset " << preset + 1 << " over " << beats << " beats" << std::endl;
+    activePreset = preset;
+    for (size_t i = 0; i < properties.size(); i++) {
+        // Leave unchanged properties alone so their rules stay quiet.
+        float const from = properties[i]->getScale();
+        if (std::isnan(scales[i]) || scales[i] == from) {
+            continue;
+        }
+        tweens.stop(encoderTweens[i]);
+        encoderTweens[i] = TweenPool::INVALID_ID;
+        if (beats > 0) {
+            TweenPool::Tween tween;
+            tween.target = propertyHandles[i];
+            tween.shape = TweenPool::RAMP;
+            tween.from = from;
+            tween.to = scales[i];
+            tween.periodBeats = beats;
+            tween.cycles = 1;
+            encoderTweens[i] = tweens.start(tween, beat);
+        } else {
+            properties[i]->setScale(scales[i]);
+            encoders[i]->setScale(scales[i]);
+            propertyGraph.markDirty(propertyHandles[i]);
+        }
+    }
+}
+
+void ofApp::storePreset(int preset) {
+    presets.store(preset, properties);
+    activePreset = preset;
+    std::cout << "Stored preset " << preset + 1 << std::endl;
+}
+
 void ofApp::setupOpenFrameworks() {
-    ofSetFrameRate(60.0f);
+    if (offline.isEnabled()) {
+        // Render as fast as the machine allows; the clock sets the pace.
+        ofSetFrameRate(0);
+        ofSetVerticalSync(false);
+    } else {
+        ofSetFrameRate(60.0f);
+    }
     ofSetCurveResolution(100);
     ofEnableBlendMode(OF_BLENDMODE_ALPHA);
 }
@@ -55,14 +302,14 @@ void ofApp::setupProperties() {
     rangeY.setMax(ofVec2f(-stageSize[1]*0.5, stageSize[1]*0.5));
     rangeZ.setMax(ofVec2f(-stageSize[2]*0.5, stageSize[2]*0.5));
     
-    velocityX.addSubscriber([&]() { updateVelocity(); });
-    velocityY.addSubscriber([&]() { updateVelocity(); });
-    velocityZ.addSubscriber([&]() { updateVelocity(); });
-    
-    master.addSubscriber([&]() { tracerCount = tracerCount.map(master);});
-    master.addSubscriber([&]() { hue = hue.map(master); });
-    
-    blendMode.addSubscriber([&]() {
+    auto handle = [&](property_base* property) { return propertyGraph.add(property); };
+    propertyGraph.addRule({handle(δ(velocityX)), handle(δ(velocityY)), handle(δ(velocityZ))}, {handle(δ(velocity))}, [&]() { updateVelocity(); });
+    propertyGraph.addRule({handle(δ(stageSize)), handle(δ(maxPoints)), handle(δ(strokeWidth))}, {}, [&]() { simulationInput.strokeGeneration++; });
+    propertyGraph.addRule({handle(δ(master))}, {handle(δ(tracerCount)), handle(δ(hue))}, [&]() {
+        tracerCount = tracerCount.map(master);
+        hue = hue.map(master);
+    });
+    propertyGraph.addRule({handle(δ(blendMode))}, {}, [&]() {
         switch (blendMode) {
             case 0:
                 currentBlendMode = OF_BLENDMODE_ALPHA;
@@ -85,6 +332,27 @@ void ofApp::setupProperties() {
         }
     });
     
+    propertyGraph.addRule({handle(δ(updateThreads))}, {}, [&]() { simulationInput.threadCount = updateThreads; });
+    // Offline renders must not depend on how fast the machine is.
+    propertyGraph.addRule({handle(δ(adaptiveQuality))}, {}, [&]() { governor.setEnabled(adaptiveQuality && !offline.isEnabled()); });
+    propertyGraph.addRule({handle(δ(frameBudgetMillis))}, {}, [&]() { governor.setBudget(frameBudgetMillis); });
+    propertyGraph.addRule({handle(δ(recordSession))}, {}, [&]() { updateSessionRecording(); });
+    propertyGraph.addRule({handle(δ(simulationRate))}, {}, [&]() { updateSimulationThread(); });
+    propertyGraph.addRule({handle(δ(strokeBackend))}, {}, [&]() { updateStrokeBackend(); });
+    engineProperties.push_back(δ(updateThreads));
+    engineProperties.push_back(δ(followAudioTempo));
+    engineProperties.push_back(δ(recordRawFrames));
+    engineProperties.push_back(δ(v4l2Device));
+    engineProperties.push_back(δ(presetMorphBeats));
+    engineProperties.push_back(δ(adaptiveQuality));
+    engineProperties.push_back(δ(frameBudgetMillis));
+    engineProperties.push_back(δ(recordSession));
+    engineProperties.push_back(δ(simulationRate));
+    engineProperties.push_back(δ(strokeBackend));
+    for (auto property : engineProperties) {
+        handle(property);
+    }
+    
     property_base* bank[4][4][4] = {
         {
             {δ(tracerCount), δ(maxPoints), δ(maxShift), δ(multiplierCount)},
@@ -95,7 +363,7 @@ void ofApp::setupProperties() {
         {
             {δ(velocityX), δ(velocityY), δ(velocityZ), δ(boxSize)},
             {δ(boxTransparency), δ(blendMode), δ(beatsPerMinute), nullptr},
-            {nullptr, nullptr, nullptr, nullptr},
+            {δ(repulsion), δ(flocking), δ(interactionRadius), δ(sparks)},
             {nullptr, nullptr, nullptr, nullptr}
         },
         {
@@ -118,12 +386,16 @@ void ofApp::setupProperties() {
                 auto property = bank[bankIndex][rowIndex][colIndex];
                 if (property != nullptr) {
                     properties.push_back(property);
+                    propertyHandles.push_back(handle(property));
                 }
             }
         }
     }
 
     loadPropertiesFromXml(ofApp::SETTINGS_FILE);
+    if (offline.strokeBackend != StrokeMesh::BACKEND_COUNT) {
+        strokeBackend = offline.strokeBackend;
+    }
     
     int encoderIndex = 0;
     for (int bankIndex = 0; bankIndex < MAX_BANKS; bankIndex++) {
@@ -146,6 +418,7 @@ void ofApp::bindEncoder(property<T>& property) {
 template <class T>
 void ofApp::registerProperty(property<T>& property) {
     properties.push_back(static_cast<property_base*>(&property));
+    propertyHandles.push_back(propertyGraph.add(&property));
 }
 
 void ofApp::setupRenderer() {
@@ -156,109 +429,252 @@ void ofApp::setupRenderer() {
     ofSetCurrentRenderer(shivaVGRenderer);
 }
 
-ofColor randomColor(ofVec2f redRange, ofVec2f blueRange, ofVec2f greenRange) {
-    return ofColor(ofRandom(redRange[0], redRange[1]), ofRandom(blueRange[0], blueRange[1]), ofRandom(greenRange[0], greenRange[1]));
+void ofApp::updateStrokeBackend() {
+    auto const backend = (StrokeMesh::Backend)(int)strokeBackend;
+    simulationInput.strokeBackend = backend;
+    // The mesh backend draws with its own shader under either renderer.
+    ofSetCurrentRenderer(backend == StrokeMesh::GL_LINES ? defaultRenderer : shivaVGRenderer);
+    std::cout << "Drawing strokes with " << StrokeMesh::getBackendName(backend) << std::endl;
 }
 
-ofVec3f ofApp::getRandomInStage(ofVec3f stageSize) {
-    float x = ofRandom(stageSize[0]);
-    float y = ofRandom(stageSize[1]);
-    float z = ofRandom(-stageSize[2], stageSize[2]);
-    return ofVec3f(x, y, z);
+TracerPool::Frame ofApp::makeTracerFrame(float currentTime) {
+    TracerPool::Frame frame;
+    frame.time = currentTime;
+    frame.rangeX = rangeX;
+    frame.rangeY = rangeY;
+    frame.rangeZ = rangeZ;
+    frame.boxSize = ofVec3f(box.getWidth(), box.getHeight(), box.getDepth());
+    auto const decisions = governor.getDecisions();
+    frame.maxPoints = maxPoints;
+    frame.farMaxPoints = maxPoints * decisions.farTrailFraction;
+    frame.viewNormal = getViewNormal(getViewAngle());
+    frame.curveResolution = std::min(ofGetStyle().curveResolution, decisions.curveResolution);
+    frame.repulsion = repulsion;
+    frame.flocking = flocking;
+    frame.interactionRadius = interactionRadius;
+    // Sparks where trails visibly cross, so within a stroke width.
+    frame.sparkDistance = sparks ? strokeWidth : 0;
+    return frame;
 }
 
-Tracer* ofApp::makeTracer() {
-    ofPoint timeShift(ofRandom(stageSize[0]), ofRandom(stageSize[1]), ofRandom(stageSize[2]));
-    auto startingLocation = getRandomInStage(stageSize);
-    auto tracer = new Tracer(startingLocation, stageSize);
-    
-    // Update behaviors
-    tracer->addUpdateBehavior(new SetHeadToZeroEveryUpdate());
-    tracer->addUpdateBehavior(new PerlinMovement(velocity, timeShift, rangeX, rangeY, rangeZ));
-    tracer->addUpdateBehavior(new ProjectOntoBox(&box));
-    tracer->addUpdateBehavior(new MaximumLength(maxPoints));
-    tracer->addUpdateBehavior(new HeadGrowth);
-    tracer->addUpdateBehavior(new CurvedPath);
-    
-    // Draw behaviors
-    StrokeColor* stroke = new StrokeColor(ofColor::black);
-    tracer->addDrawBehavior(new Hue(stroke, hue));
-    tracer->addDrawBehavior(new Saturation(stroke, saturation));
-    tracer->addDrawBehavior(new Brightness(stroke, brightness));
-//    tracer->addDrawBehavior(new InvertHue(stroke));
-    tracer->addDrawBehavior(stroke);
-    tracer->addDrawBehavior(new StrokeWidth(strokeWidth));
-    tracer->addDrawBehavior(new DrawPath);
-    tracer->addDrawBehavior(new VibratingMultiplier(new Multiplier(multiplierCount, maxShift), entropy));
-    tracer->addDrawBehavior(new FilledPath(false, ofColor::black));
-//    tracer->addDrawBehavior(new SphereHead(strokeWidth));
-//    tracer->addDrawBehavior(new EllipseTail(strokeWidth));
-    
-    return tracer;
-}
-
-StrokeColor* ofApp::makeRandomStrokeColorBehavior() {
-    ofVec2f redRange = {225, 255};
-    ofVec2f blueRange = {225, 255};
-    ofVec2f greenRange = {225, 255};
-    int const colorsSize = 5;
-    ofColor colors[] = {
-        randomColor(redRange, blueRange, greenRange),
-        randomColor(redRange, blueRange, greenRange),
-        randomColor(redRange, blueRange, greenRange),
-        randomColor(redRange, blueRange, greenRange),
-        randomColor(redRange, blueRange, greenRange)
-    };
-    
-    return new RandomStrokeColor(colors, colorsSize);
+TracerPool::Style ofApp::makeTracerStyle(float angle) {
+    TracerPool::Style style;
+    style.strokeColor = ofColor::fromHsb(hue, saturation, brightness);
+    style.strokeWidth = strokeWidth;
+    style.multiplierCount = std::min<int>(multiplierCount, governor.getDecisions().maxMultiplierCount);
+    style.maxShift = maxShift;
+    style.entropy = entropy;
+    style.viewNormal = getViewNormal(angle);
+    return style;
+}
+
+float ofApp::getViewAngle() {
+    float const time = clock.getElapsedTimef() + streamOffsetMillis / 1000;
+    return time * rotationSpeed + stream.viewAngle;
+}
+
+ofVec3f ofApp::getViewNormal(float angle) {
+    // Undo the rotations draw() applies to find the viewer in tracer space.
+    ofVec3f normal(0, 0, 1);
+    normal.rotate(-angle, ofVec3f(0, 1, 0));
+    normal.rotate(-45, ofVec3f(0, 1, 0));
+    normal.rotate(-45, ofVec3f(1, 0, 0));
+    return normal;
 }
 
 void ofApp::setupTracers() {
-    for (int i = 0; i < tracerCount; i++) {
-        tracers.push_back(makeTracer());
+    BatchNoise::setup();
+    simulation.setProfiler(&profiler);
+    simulationInput.velocity = velocity;
+    simulationInput.threadCount = updateThreads;
+}
+
+void ofApp::updateSimulationThread() {
+    // Offline renders tick once a frame so their output stays deterministic,
+    // and render nodes follow the stream as it arrives.
+    if (simulationRate > 0 && !offline.isEnabled() && !isRenderNode()) {
+        simulation.start(simulationRate, clock.getElapsedTimeMillis());
+    } else {
+        simulation.stop();
+    }
+}
+
+bool ofApp::isRenderNode() const {
+    return stream.isRenderNode();
+}
+
+void ofApp::setupStream() {
+    if (stream.isStreaming()) {
+        if (!streamSender.open(stream.destinations)) {
+            std::cout << "Could not stream to " << ofJoinString(stream.destinations, ", ") << std::endl;
+            ofExit(1);
+            return;
+        }
+        simulation.setSender(&streamSender);
+        std::cout << "Streaming ticks to " << ofJoinString(stream.destinations, ", ") << std::endl;
+    }
+    if (isRenderNode()) {
+        if (!streamReceiver.open(stream.listenAddress)) {
+            std::cout << "Could not listen on " << stream.listenAddress << std::endl;
+            ofExit(1);
+            return;
+        }
+        std::cout << "Rendering ticks streamed to " << stream.listenAddress << ", turned " << stream.viewAngle << " degrees" << std::endl;
+    }
+    lastStreamReportMillis = clock.getElapsedTimeMillis();
+}
+
+bool ofApp::receiveStream() {
+    if (!isRenderNode()) {
+        return false;
+    }
+
+    // Properties arriving now take effect in the next frame's trimming.
+    TracerPool::Frame const frame = makeTracerFrame(clock.getElapsedTimeMillis());
+    bool received = false;
+    while (streamReceiver.receive(streamTick)) {
+        for (auto const& value : streamTick.properties) {
+            if (value.index < properties.size()) {
+                properties[value.index]->setScale(value.scale);
+                propertyGraph.markDirty(propertyHandles[value.index]);
+            }
+        }
+        simulation.follow(frame, streamTick.heads, streamTick.tracerCount);
+
+        // Smoothed, so that arrival jitter does not shake the rotation.
+        double const offset = streamTick.millis - (double)clock.getElapsedTimeMillis();
+        if (streamReceiver.getStats().ticks == 1) {
+            streamOffsetMillis = offset;
+        } else {
+            streamOffsetMillis += (offset - streamOffsetMillis) * STREAM_CLOCK_SMOOTHING;
+        }
+        received = true;
+    }
+    return received;
+}
+
+void ofApp::reportStream() {
+    if (ofGetFrameNum() % STREAM_REPORT_FRAMES != 0 || (!streamSender.isOpen() && !isRenderNode())) {
+        return;
+    }
+
+    uint64_t const millis = clock.getElapsedTimeMillis();
+    float const seconds = std::max<uint64_t>(millis - lastStreamReportMillis, 1) / 1000.0;
+    lastStreamReportMillis = millis;
+    if (streamSender.isOpen()) {
+        auto const stats = streamSender.getStats();
+        uint64_t const ticks = stats.ticks - lastSenderStats.ticks;
+        uint64_t const bytes = (stats.bytes - lastSenderStats.bytes) / stream.destinations.size();
+        std::cout << "Streamed " << ticks << " ticks: " << (ticks > 0 ? bytes / ticks : 0) << " bytes per tick, "
+            << bytes / 1024.0 / seconds << " KB/s per node, " << stats.keyframes - lastSenderStats.keyframes << " keyframes, "
+            << stats.dropped - lastSenderStats.dropped << " dropped" << std::endl;
+        lastSenderStats = stats;
+    }
+    if (isRenderNode()) {
+        auto const stats = streamReceiver.getStats();
+        uint64_t const ticks = stats.ticks - lastReceiverStats.ticks;
+        uint64_t const bytes = stats.bytes - lastReceiverStats.bytes;
+        auto const age = profiler.getSummary(Profiler::TICK_TO_DRAW);
+        std::cout << "Received " << ticks << " ticks: " << (ticks > 0 ? bytes / ticks : 0) << " bytes per tick, "
+            << bytes / 1024.0 / seconds << " KB/s, " << stats.lost - lastReceiverStats.lost << " lost, "
+            << stats.skipped - lastReceiverStats.skipped << " skipped, tick to draw p50 " << age.p50Micros / 1000
+            << " ms, p99 " << age.p99Micros / 1000 << " ms" << std::endl;
+        lastReceiverStats = stats;
     }
 }
 
 void ofApp::setupSoundStream() {
     soundStream.printDeviceList();
     int bufferSize = 256;
-    left.assign(bufferSize, 0.0);
-    right.assign(bufferSize, 0.0);
+    int sampleRate = 44100;
     volHistory.assign(400, 0.0);
+    volHistoryNext = 0;
     smoothedVol = 0.0;
     scaledVol = 0.0;
-    soundStream.setup(this, 0, 1, 44100, bufferSize, 4);
+    if (offline.isEnabled() || isReplaying() || isRenderNode()) {
+        return;
+    }
+    audioAnalyzer.start(sampleRate, bufferSize);
+    soundStream.setup(this, 0, 1, sampleRate, bufferSize, 4);
     soundStream.start();
 }
 
 void ofApp::setupMidiFighterTwister() {
-    twister.setup();
-    ofAddListener(twister.eventEncoder, this, &ofApp::onEncoderUpdate);
-    ofAddListener(twister.eventPushSwitch, this, &ofApp::onPushSwitchUpdate);
-    ofAddListener(twister.eventSideButton, this, &ofApp::onSideButtonPressed);
+    if (!offline.isEnabled() && !isReplaying() && !isRenderNode()) {
+        twister.setup();
+        ofAddListener(twister.eventEncoder, this, &ofApp::onEncoderUpdate);
+        ofAddListener(twister.eventPushSwitch, this, &ofApp::onPushSwitchUpdate);
+        ofAddListener(twister.eventSideButton, this, &ofApp::onSideButtonPressed);
+    }
     for (int i = 0; i < ofxMidiFighterTwister::NUM_ENCODERS; i++) {
-        easings[i] = nullptr;
+        encoderTweens[i] = TweenPool::INVALID_ID;
         encoders[i] = new encoder(i, 0, 127, &twister);
     }
 }
 
 void ofApp::onEncoderUpdate(ofxMidiFighterTwister::EncoderEventArgs& a){
-    if (a.ID < properties.size()) {
-        std::cout << "onEncoderUpdate(" << a.ID << "): Setting " << properties[a.ID]->getName() << " to MIDI " << a.value << std::endl;
-        encoders[a.ID]->setValue(a.value);
-    }
+    midiQueue.push(MidiQueue::ENCODER, a.ID, a.value, profiler.now());
 }
 
 void ofApp::onPushSwitchUpdate(ofxMidiFighterTwister::PushSwitchEventArgs& a){
-    std::cout << "PushSwitch '" << a.ID << "' Event! val: " << a.value << std::endl;
-    if (a.value == 0)
-        tweenEncoderToCurrentValue(a.ID);
+    midiQueue.push(MidiQueue::PUSH_SWITCH, a.ID, a.value, profiler.now());
+}
+
+void ofApp::applyMidiEvents() {
+    uint64_t const now = profiler.now();
+    // Last frame's events are on screen now that its buffers have swapped.
+    for (auto arrival : midiArrivals) {
+        profiler.record(Profiler::MIDI_TO_FRAME, arrival, now - arrival);
+    }
+    midiArrivals.clear();
+
+    uint64_t const micros = clock.getElapsedTimeMicros();
+    midiLog.replay(micros, midiQueue, now);
+    midiQueue.drain(midiEvents);
+    for (auto const& event : midiEvents) {
+        midiLog.record(micros, event);
+        sessionLog.append((SessionLog::Type)(SessionLog::MIDI_ENCODER + event.control), event.id, event.value);
+        midiArrivals.push_back(event.nanos);
+        switch (event.control) {
+            case MidiQueue::ENCODER:
+                if (event.id < properties.size()) {
+                    encoders[event.id]->setValue(event.value);
+                    propertyGraph.markDirty(propertyHandles[event.id]);
+                }
+                break;
+            case MidiQueue::PUSH_SWITCH:
+                std::cout << "PushSwitch '" << event.id << "' Event! val: " << event.value << std::endl;
+                if (event.value == 0)
+                    tweenEncoderToCurrentValue(event.id);
+                break;
+            case MidiQueue::SIDE_BUTTON:
+                std::cout << "Side button " << event.id << " pressed" << std::endl;
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void ofApp::toggleMidiRecording() {
+    if (midiLog.isRecording()) {
+        midiLog.stopRecording();
+        std::cout << "Stopped recording MIDI" << std::endl;
+        return;
+    }
+
+    std::string const path = ofToDataPath("midi-" + ofGetTimestampString() + ".csv");
+    if (midiLog.startRecording(path)) {
+        std::cout << "Recording MIDI to " << path << std::endl;
+    } else {
+        std::cout << "Could not write " << path << std::endl;
+    }
 }
 
 void ofApp::tweenEncoderToCurrentValue(int encoderIndex) {
-    if (easings[encoderIndex] != nullptr) {
-        delete easings[encoderIndex];
-        easings[encoderIndex] = nullptr;
+    if (tweens.isActive(encoderTweens[encoderIndex])) {
+        tweens.stop(encoderTweens[encoderIndex]);
+        encoderTweens[encoderIndex] = TweenPool::INVALID_ID;
         return;
     }
     
@@ -266,80 +682,121 @@ void ofApp::tweenEncoderToCurrentValue(int encoderIndex) {
 }
 
 void ofApp::jumpRope(int encoderIndex) {
+    if (encoderIndex >= properties.size()) {
+        return;
+    }
+
     auto encoder = encoders[encoderIndex];
     auto property = properties[encoderIndex];
-    TimeDiff const microsPerSecond = 1e6;
-    float const startTime = ofGetElapsedTimeMicros();
     float const jumpRopeDurationInBeats = 4.0;
-    float const beatsPerSecond = beatsPerMinute / 60.0;
-    float const jumpRopeDurationInSeconds = jumpRopeDurationInBeats / beatsPerSecond;
-    float const secondsPerBeat = 1.0f / beatsPerSecond;
-    TimeDiff forwardDuration = jumpRopeDurationInSeconds / 2.0 * microsPerSecond;
-    TimeDiff backwardDuration = forwardDuration;
-    float initialValue = encoder->getScale();
-    std::cout << "Tweening property " << property->getName() << " from " << initialValue << " to 0 between t = [" << startTime << ", " << startTime + forwardDuration << "]" << " and back to " << initialValue << " between t = [" << startTime + forwardDuration << ", " << startTime + forwardDuration + backwardDuration << "]" << std::endl;
-    easings[encoderIndex] = new ease(forwardDuration, backwardDuration, initialValue, 0, ofxeasing::linear::easeIn);
+    TweenPool::Tween tween;
+    tween.target = propertyHandles[encoderIndex];
+    tween.shape = TweenPool::TRIANGLE;
+    tween.from = encoder->getScale();
+    tween.to = 0;
+    tween.periodBeats = jumpRopeDurationInBeats;
+    std::cout << "Tweening property " << property->getName() << " from " << tween.from << " to 0 and back every " << jumpRopeDurationInBeats << " beats from beat " << beat << std::endl;
+    encoderTweens[encoderIndex] = tweens.start(tween, beat);
 }
-
 void ofApp::onSideButtonPressed(ofxMidiFighterTwister::SideButtonEventArgs & a){
-    std::cout << "Side button " << a.buttonID << " pressed" << std::endl;
+    midiQueue.push(MidiQueue::SIDE_BUTTON, a.buttonID, 1, profiler.now());
 }
 
 void ofApp::updateVelocity() {
     velocity = ofVec3f(velocityX, velocityY, velocityZ);
-    velocity.clean();
+    simulationInput.velocity = velocity;
 }
 
 void ofApp::update() {
-    float currentTime = ofGetElapsedTimeMillis();
+    frameStartNanos = profiler.now();
+    profiler.collect();
+    sessionLog.beginFrame(clock.getElapsedTimeMicros(), ofGetFrameNum(), lastFrameMillis);
+    replaySession();
+    applyMidiEvents();
+    readAudio();
+    bool const streamed = receiveStream();
+    float currentTime = clock.getElapsedTimeMillis();
     
-    int oldTracerCount = tracerCount;
-    for (auto& global : properties) {
-        global->clean();
+    if (followAudioTempo && tempoConfidence > MIN_TEMPO_CONFIDENCE) {
+        beatsPerMinute = tempo;
+        propertyGraph.markDirty(δ(beatsPerMinute));
     }
-    stageSize.clean();
 
-    TimeDiff currentTimeMicros = ofGetElapsedTimeMicros();
-    for (int i = 0; i < ofxMidiFighterTwister::NUM_ENCODERS; i++) {
-        auto easing = easings[i];
-        if (easing != nullptr) {
-            float v = easing->update(currentTimeMicros);
-            properties[i]->setScale(v);
-            encoders[i]->setScale(v);
-            if (easing->isDone(currentTimeMicros)) {
-                delete easing;
-                easings[i] = nullptr;
-                jumpRope(i);
+    {
+        Profiler::Scope scope(&profiler, Profiler::EASING);
+        // Accumulate beats so a tempo change bends tweens instead of jumping them.
+        beat += (currentTime - time) / 60000.0 * beatsPerMinute;
+        tweens.update(beat, propertyGraph);
+        for (int i = 0; i < ofxMidiFighterTwister::NUM_ENCODERS; i++) {
+            if (tweens.isActive(encoderTweens[i])) {
+                encoders[i]->setScale(properties[i]->getScale());
             }
         }
     }
-    
-    for (int i = 0; i < abs(tracerCount - oldTracerCount); i++) {
-        if (tracerCount > oldTracerCount) {
-            tracers.push_back(makeTracer());
-        } else {
-            tracers.pop_back();
+
+    {
+        Profiler::Scope scope(&profiler, Profiler::CLEAN);
+        propertyGraph.update();
+        if (sessionLog.isRecording()) {
+            for (auto handle : propertyGraph.getCleaned()) {
+                sessionLog.append(SessionLog::PROPERTY, handle, propertyGraph.get(handle)->getScale());
+            }
         }
     }
     
-    if (tracers.size() > 0) {
-        for (auto& t : tracers) {
-            t->update(currentTime);
+    simulationInput.frame = makeTracerFrame(currentTime);
+    simulationInput.style = makeTracerStyle(getViewAngle());
+    simulationInput.tracerCount = tracerCount;
+    simulationInput.stageSize = stageSize;
+    simulation.setInput(simulationInput);
+    if (isRenderNode()) {
+        if (streamed) {
+            simulation.publish(simulationInput, streamTick.millis, streamTick.sentNanos);
         }
+    } else if (!simulation.isThreaded()) {
+        simulation.step();
     }
+    if (streamSender.isOpen()) {
+        for (size_t i = 0; i < properties.size(); i++) {
+            streamSender.setProperty(i, properties[i]->getScale());
+        }
+    }
+    reportStream();
     
     scaledVol = ofMap(smoothedVol, 0.0, 0.17, 0.0, 1.0, true);
-    volHistory.push_back(scaledVol);
-    if (volHistory.size() >= 400) {
-        volHistory.erase(volHistory.begin(), volHistory.begin()+1);
-    }
+    volHistory[volHistoryNext] = scaledVol;
+    volHistoryNext = (volHistoryNext + 1) % volHistory.size();
     
     time = currentTime;
     drawFPS();
 }
 
 void ofApp::draw() {
-    float currentTime = ofGetElapsedTimeMillis();
+    if (offline.isEnabled()) {
+        offlineTarget.begin();
+        drawScene();
+        recorder.capture(offline.width, offline.height);
+        offlineTarget.end();
+        recordTickAge();
+        finishOfflineFrame();
+    } else {
+        drawScene();
+        recordTickAge();
+        recorder.capture(ofGetWidth(), ofGetHeight());
+        reportRecording();
+        {
+            Profiler::Scope scope(&profiler, Profiler::VIDEO_OUTPUT);
+            for (auto& output : videoOutputs) {
+                output->publishScreen(ofGetWidth(), ofGetHeight());
+            }
+        }
+        updateGovernor();
+        profiler.drawOverlay(10, 20);
+    }
+    clock.advance();
+}
+
+void ofApp::drawScene() {
     auto stageCenter = getStageCenter(stageSize);
 
     {
@@ -348,8 +805,7 @@ void ofApp::draw() {
         ofEnableDepthTest();
         ofEnableBlendMode(currentBlendMode);
 
-        float time = ofGetElapsedTimef();
-        float angle = time * rotationSpeed;
+        float angle = getViewAngle();
         ofRotate(angle, 0, 1, 0);
         ofRotate(45, 0, 1, 0);
         ofRotate(45, 1, 0, 0);
@@ -358,10 +814,20 @@ void ofApp::draw() {
         background.setHsb(backgroundHue, backgroundSaturation, backgroundBrightness);
         ofBackground(background);
 
-        for (auto& t : tracers) {
-            t->draw(currentTime, ofGetCurrentRenderer());
+        if (offline.isEnabled()) {
+            // So DRAW covers the GPU drawing the strokes, not just the calls
+            // queueing it, and none of the work queued before them.
+            glFinish();
+        }
+        {
+            Profiler::Scope scope(&profiler, Profiler::DRAW);
+            simulation.draw(makeTracerStyle(angle));
+            if (offline.isEnabled()) {
+                glFinish();
+            }
         }
         
+        Profiler::Scope scope(&profiler, Profiler::BOX_DRAW);
         ofPushStyle();
         ofColor boxColor = ofColor::fromHsb(255 - hue, saturation, brightness);
         ofSetColor(boxColor, boxTransparency);
@@ -372,8 +838,6 @@ void ofApp::draw() {
         ofPopMatrix();
         ofPopStyle();
     }
-
-    mainOutputSyphonServer.publishScreen();
 }
 
 ofVec2f ofApp::getBoxSideRange(int dimension, ofMesh boxSideMesh) {
@@ -390,43 +854,137 @@ ofVec2f ofApp::getBoxSideRange(int dimension, ofMesh boxSideMesh) {
     return range;
 }
 
+void ofApp::recordTickAge() {
+    uint64_t const produced = simulation.getDrawnNanos();
+    uint64_t const drawn = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (produced == 0 || drawn < produced) {
+        return;
+    }
+    uint64_t const age = drawn - produced;
+    uint64_t const now = profiler.now();
+    profiler.record(Profiler::TICK_TO_DRAW, now > age ? now - age : 0, age);
+}
+
+void ofApp::toggleRecording() {
+    if (recorder.isRecording()) {
+        // Reported by reportRecording() once the queued frames are written.
+        recorder.stop();
+        std::cout << "Stopped recording, writing the frames already captured" << std::endl;
+        return;
+    }
+
+    std::string const directory = ofToDataPath("recordings/" + ofGetTimestampString());
+    recorder.start(directory, recordRawFrames ? FrameRecorder::RAW_SEQUENCE : FrameRecorder::PNG_SEQUENCE);
+    std::cout << "Recording to " << directory << std::endl;
+}
+
+void ofApp::reportRecording() {
+    if (recorder.hasFinished()) {
+        auto const stats = recorder.getStats();
+        std::cout << "Finished recording: " << stats.written << " frames written, " << stats.dropped << " dropped" << std::endl;
+    }
+}
+
+void ofApp::exportProfile(std::string const& name) {
+    std::string const csv = ofToDataPath(name + ".csv");
+    std::string const trace = ofToDataPath(name + ".json");
+    if (profiler.exportCsv(csv) && profiler.exportChromeTrace(trace)) {
+        std::cout << "Wrote " << csv << " and " << trace << std::endl;
+    } else {
+        std::cout << "Could not write " << csv << " or " << trace << std::endl;
+    }
+}
+
+void ofApp::updateGovernor() {
+    // CPU time only; the GPU runs behind and shows up as a longer swap. A
+    // threaded simulation has to keep up too, so the slower of the two counts.
+    float const frameMillis = std::max((profiler.now() - frameStartNanos) / 1e6, (double)simulation.getTickMillis());
+    lastFrameMillis = frameMillis;
+    if (governor.update(frameMillis)) {
+        std::cout << "Frame takes " << governor.getAverageMillis() << " ms of " << frameBudgetMillis << ": " << governor.describe() << std::endl;
+    }
+}
+
 void ofApp::drawFPS() {
+    // Retitling the window every frame costs more than it tells anyone.
+    if (ofGetFrameNum() % TITLE_UPDATE_FRAMES != 0) {
+        return;
+    }
     ofSetColor(255, 255, 255);
     stringstream m;
     m << "FPS: " << (int)ofGetFrameRate();
+    if (governor.getLevel() > 0) {
+        m << " | " << governor.describe();
+    }
     ofSetWindowTitle(m.str());
 }
 
-void ofApp::audioIn(float * input, int bufferSize, int nChannels) {
-    float curVol = 0.0;
-    int numCounted = 0;
-    for (int i = 0; i < bufferSize; i++) {
-        left[i]	= input[i]*0.5;
-        curVol += left[i] * left[i];
+void ofApp::readAudio() {
+    if (isReplaying() || isRenderNode()) {
+        return;
     }
-    
-    curVol /= bufferSize;
-    curVol = sqrt(curVol);
-    
-    smoothedVol *= 0.93;
-    smoothedVol += 0.07 * curVol;
+
+    float const volume = audioAnalyzer.getSmoothedVolume();
+    float const newTempo = audioAnalyzer.getTempo();
+    float const newTempoConfidence = audioAnalyzer.getTempoConfidence();
+    // Levels only go in the log when they change.
+    if (volume != smoothedVol) {
+        smoothedVol = volume;
+        sessionLog.append(SessionLog::AUDIO_VOLUME, 0, volume);
+    }
+    if (newTempo != tempo) {
+        tempo = newTempo;
+        sessionLog.append(SessionLog::AUDIO_TEMPO, 0, tempo);
+    }
+    if (newTempoConfidence != tempoConfidence) {
+        tempoConfidence = newTempoConfidence;
+        sessionLog.append(SessionLog::AUDIO_TEMPO_CONFIDENCE, 0, tempoConfidence);
+    }
+}
+
+void ofApp::audioIn(float * input, int bufferSize, int nChannels) {
+    audioAnalyzer.write(input, bufferSize, nChannels);
 }
 
 void ofApp::keyPressed(int key) { }
 
 void ofApp::keyReleased(int key) {
-    if (key == 'f') {
-        ofToggleFullscreen();
-        stageSize = getStageSize();
-    } else if (key == 'x') {
-        screenGrabber.grabScreen(0, 0 , ofGetWidth(), ofGetHeight());
-        screenGrabber.save("screenshot.png");
-    } else if (key == 's') {
+    if (key == 'x') {
+        recorder.screenshot(ofToDataPath("screenshot.png"));
+    } else if (key == 'r') {
+        toggleRecording();
+    } else if (key == 'm') {
+        toggleMidiRecording();
+    } else if (key == 'S') {
         savePropertiesToXml(ofApp::SETTINGS_FILE);
     } else if (key == 'e') {
         soundStream.stop();
+    } else if (key == 'p') {
+        profiler.toggleOverlay();
+    } else if (key == 'P') {
+        exportProfile("profile");
     } else if (key == 'q') {
         exit();
+    } else {
+        sessionLog.append(SessionLog::KEY, key, 0);
+        performKey(key);
+    }
+}
+
+void ofApp::performKey(int key) {
+    if (key == 'f') {
+        ofToggleFullscreen();
+        stageSize = getStageSize();
+        propertyGraph.markDirty(δ(stageSize));
+    } else if (key == 's') {
+        storePreset(activePreset);
+    } else if (key == 'L') {
+        loadPropertiesFromXml(ofApp::SETTINGS_FILE);
+    } else if (key == 'b') {
+        strokeBackend = (strokeBackend + 1) % StrokeMesh::BACKEND_COUNT;
+        propertyGraph.markDirty(δ(strokeBackend));
+    } else if (key >= OF_KEY_F1 && key <= OF_KEY_F12) {
+        recallPreset(key - OF_KEY_F1, presetMorphBeats);
     } else if (key >= '0' && key <= '9') {
         armedPropertyIndex = key - '0';
         std::cout << "Arming " << properties[armedPropertyIndex]->getName() << std::endl;
@@ -434,10 +992,12 @@ void ofApp::keyReleased(int key) {
         property_base* p = properties[armedPropertyIndex];
         float newScale = p->getScale() + 0.01;
         p->setScale(newScale);
+        propertyGraph.markDirty(propertyHandles[armedPropertyIndex]);
     } else if (key == 359 /* down */) {
         property_base* p = properties[armedPropertyIndex];
         float newScale = p->getScale() - 0.01;
         p->setScale(newScale);
+        propertyGraph.markDirty(propertyHandles[armedPropertyIndex]);
     }
 }
 
@@ -5,13 +5,32 @@
 #include "ofxMidiFighterTwister.h"
 #include "ofxXmlSettings.h"
 #include "ofxEasing.h"
-#include "ofxSyphon.h"
 #include "ofxBenG.h"
+#include "AudioAnalyzer.h"
+#include "Clock.h"
+#include "FrameRecorder.h"
+#include "MidiLog.h"
+#include "OfflineRender.h"
+#include "Profiler.h"
+#include "SharedMemoryVideoOutput.h"
+#include "SyphonVideoOutput.h"
+#include "V4l2VideoOutput.h"
+#include "PresetBank.h"
+#include "PropertyGraph.h"
+#include "QualityGovernor.h"
+#include "SessionLog.h"
+#include "Simulation.h"
+#include "StreamOptions.h"
+#include "StreamReceiver.h"
+#include "StreamSender.h"
+#include "TweenPool.h"
+#include <chrono>
 #include <limits.h>
 
 class ofApp : public ofBaseApp {
     
 public:
+    ofApp(OfflineRender const& offline = OfflineRender(), std::string const& replayPath = "", StreamOptions const& stream = StreamOptions());
     virtual ~ofApp();
     void setup();
     void update();
@@ -19,6 +38,8 @@ public:
     
     void keyPressed(int key);
     void keyReleased(int key);
+    // Keys that change the show, and so are logged and replayed.
+    void performKey(int key);
     void mouseMoved(int x, int y);
     void mouseDragged(int x, int y, int button);
     void mousePressed(int x, int y, int button);
@@ -31,20 +52,48 @@ public:
     
 private:
     void drawFPS();
+    int const TITLE_UPDATE_FRAMES = 30;
     void setupOpenFrameworks();
     void updateVelocity();
     void jumpRope(int encoderIndex);
     ofVec3f getStageSize();
     ofVec3f getStageCenter(ofVec3f stageSize);
-    ofVec3f getRandomInStage(ofVec3f stageSize);
-    StrokeColor* makeRandomStrokeColorBehavior();
     ofVec2f getBoxSideRange(int dimension, ofMesh boxSideMesh);
 
     float time;
+    Clock clock;
+
+    // Profiling: 'p' toggles the overlay, 'P' exports CSV and trace files.
+    Profiler profiler;
+    void exportProfile(std::string const& name);
     
-    // Syphon
-    void setupSyphon();
-    ofxSyphonServer mainOutputSyphonServer;
+    // Video output: Syphon on macOS, shared memory elsewhere, plus
+    // v4l2loopback on Linux when v4l2Device is set.
+    std::vector<std::unique_ptr<VideoOutput>> videoOutputs;
+    void setupVideoOutputs();
+
+    // Session log: written to bin/data/sessions while recordSession is on.
+    // Replaying one stands in for the Twister, keyboard and microphone.
+    SessionLog sessionLog;
+    std::string const replayPath;
+    std::vector<SessionLog::Record> replayRecords;
+    // Current handle for each handle in the log, or INVALID_HANDLE.
+    std::vector<PropertyGraph::Handle> replayHandles;
+    size_t replayNext = 0;
+    uint64_t replayStartMicros = 0;
+    float lastFrameMillis = 0;
+    bool isReplaying() const;
+    void setupReplay();
+    void replaySession();
+    void updateSessionRecording();
+
+    // Offline render
+    OfflineRender const offline;
+    ofFbo offlineTarget;
+    int offlineFrame = 0;
+    std::chrono::steady_clock::time_point offlineStart;
+    void setupOfflineRender();
+    void finishOfflineFrame();
 
     // Image
     ofImage pizza;
@@ -57,11 +106,16 @@ private:
     int armedPropertyIndex = 0;
     ofxXmlSettings settings;
     std::string SETTINGS_FILE = "settings.xml";
-    std::map<int, std::deque<ease>> propertyEasings;
     std::vector<property_base*> properties;
+    std::vector<property_base*> engineProperties;
+    // Every property, including the ones no encoder is bound to.
+    PropertyGraph propertyGraph;
+    // Graph handles in the same order as properties.
+    std::vector<PropertyGraph::Handle> propertyHandles;
     // {label, default, min, max}
     property<int> master = {"master", 0, 0, 127};
-    property<int> tracerCount = {"tracerCount", 1, 1, 127};
+    int const MAX_TRACERS = 127;
+    property<int> tracerCount = {"tracerCount", 1, 1, MAX_TRACERS};
     property<int> hue = {"hue", 0, 0, 255};
     property<int> saturation = {"saturation", 0, 0, 255};
     property<int> brightness = {"brightness", 0, 0, 255};
@@ -70,7 +124,8 @@ private:
     property<int> backgroundBrightness = {"backgroundBrightness", 0, 0, 255};
     property<float> beatsPerMinute = {"beatsPerMinute", 60, 1, 300};
     property<float> maxShift = {"maxShift", 3, 1, 8};
-    property<int> maxPoints = {"maxPoints", 100, 1, 1000};
+    int const MAX_POINTS = 1000;
+    property<int> maxPoints = {"maxPoints", 100, 1, MAX_POINTS};
     property<int> multiplierCount = {"multiplierCount", 5, 0, 255};
     property<ofVec3f> velocity = {"velocity", ofVec3f(0.001, 0.001, 0.001), ofVec3f(0, 0, 0), ofVec3f(0.005, 0.005, 0.005)};
     float const MIN_VELOCITY = 0;
@@ -89,35 +144,108 @@ private:
     property<int> boxTransparency = {"boxTransparency", 255, 0, 255};
     property<int> blendMode = {"blendMode", 0, 0, 5};
     property<ofVec3f> stageSize = {"stageSize", ofVec3f(700), ofVec3f(1e2), ofVec3f(1e4)};
+    property<float> repulsion = {"repulsion", 0, 0, 1};
+    property<float> flocking = {"flocking", 0, 0, 1};
+    property<float> interactionRadius = {"interactionRadius", 30, 1, 200};
+    property<int> sparks = {"sparks", 0, 0, 1};
+    // Engine settings: saved with the rest but not bound to an encoder.
+    property<int> updateThreads = {"updateThreads", 0, 0, 64};
+    property<int> followAudioTempo = {"followAudioTempo", 0, 0, 1};
+    property<int> recordRawFrames = {"recordRawFrames", 0, 0, 1};
+    property<int> v4l2Device = {"v4l2Device", -1, -1, 63};
+    property<float> presetMorphBeats = {"presetMorphBeats", 0, 0, 64};
+    property<int> adaptiveQuality = {"adaptiveQuality", 1, 0, 1};
+    property<float> frameBudgetMillis = {"frameBudgetMillis", 14, 1, 100};
+    property<int> recordSession = {"recordSession", 1, 0, 1};
+    // Simulation ticks per second on a thread of its own; 0 runs it on the main thread.
+    property<float> simulationRate = {"simulationRate", 60, 0, 240};
+    // A StrokeMesh::Backend; 'b' cycles through them.
+    property<int> strokeBackend = {"strokeBackend", StrokeMesh::MESH, 0, StrokeMesh::BACKEND_COUNT - 1};
     void setupProperties();
     void savePropertiesToXml(std::string& file);
     void loadPropertiesFromXml(std::string& file);
     template <typename T> void bindEncoder(property<T>& property);
     template <typename T> void registerProperty(property<T>& property);
 
+    // Presets: F1-F12 recall, morphing over presetMorphBeats; 's' stores
+    // the current scene into the preset recalled last.
+    std::string PRESETS_FILE = "presets.bin";
+    PresetBank presets;
+    int activePreset = 0;
+    void setupPresets();
+    void recallPreset(int preset, double beats);
+    void storePreset(int preset);
+
+    // Tweens, timed in beats of beatsPerMinute
+    TweenPool tweens;
+    double beat = 0;
+
+    // Streaming: with --stream-to every simulation tick also goes to render
+    // nodes; with --render-node the tracers follow that stream, and the
+    // performance properties with them, instead of moving on their own.
+    // Declared before simulation, which sends until it stops.
+    StreamOptions const stream;
+    StreamSender streamSender;
+    StreamReceiver streamReceiver;
+    StreamReceiver::Tick streamTick;
+    // The simulation node's clock minus ours, so render nodes turn in step with it.
+    double streamOffsetMillis = 0;
+    float const STREAM_CLOCK_SMOOTHING = 0.02;
+    int const STREAM_REPORT_FRAMES = 300;
+    StreamSender::Stats lastSenderStats;
+    StreamReceiver::Stats lastReceiverStats;
+    uint64_t lastStreamReportMillis = 0;
+    bool isRenderNode() const;
+    void setupStream();
+    // Follows every tick that arrived since the last frame; false if none did.
+    bool receiveStream();
+    void reportStream();
+
     // Tracer
-    std::vector<Tracer*> tracers;
-    Tracer* makeTracer();
+    Simulation simulation = {MAX_POINTS, MAX_TRACERS};
+    Simulation::Input simulationInput;
     void setupTracers();
+    void updateSimulationThread();
+    TracerPool::Frame makeTracerFrame(float currentTime);
+    TracerPool::Style makeTracerStyle(float angle);
 
     // Renderer
-    ofImage screenGrabber;
+    void drawScene();
+    // Degrees the scene has turned about the y axis.
+    float getViewAngle();
+    ofVec3f getViewNormal(float angle);
+    void recordTickAge();
+    // Lowers detail while update and draw overrun frameBudgetMillis; the
+    // window title shows what it has turned down.
+    QualityGovernor governor;
+    uint64_t frameStartNanos = 0;
+    void updateGovernor();
+    // Capture: 'x' saves a screenshot, 'r' toggles recording every frame.
+    FrameRecorder recorder;
+    void toggleRecording();
+    void reportRecording();
     ofPtr<ofBaseRenderer> defaultRenderer;
     ofPtr<ofxShivaVGRenderer> shivaVGRenderer;
     ofBlendMode currentBlendMode;
     void setupRenderer();
+    void updateStrokeBackend();
     
     // Audio
-    std::vector<float> left;
-    std::vector<float> right;
+    float const MIN_TEMPO_CONFIDENCE = 0.3;
     std::vector<float> volHistory;
+    size_t volHistoryNext;
     int bufferCounter;
     int drawCounter;
     float smoothedVol;
     float scaledVol;
+    float tempo = 0;
+    float tempoConfidence = 0;
+    AudioAnalyzer audioAnalyzer;
     ofSoundStream soundStream;
     void audioIn(float * input, int bufferSize, int nChannels);
     void setupSoundStream();
+    // Reads this frame's levels from the analyzer, unless replaying.
+    void readAudio();
     
     // Midi Fighter Twister
     int const MAX_BANKS = 4;
@@ -126,8 +254,17 @@ private:
     int encoderIndex = 0;
     int previousPushSwitchValue = -1;
     ofxMidiFighterTwister twister;
+    // The callbacks only queue events; applyMidiEvents() handles them in
+    // update(). 'm' toggles logging the applied events.
+    MidiQueue midiQueue;
+    std::vector<MidiQueue::Event> midiEvents;
+    // Arrival times of the events applied last frame.
+    std::vector<uint64_t> midiArrivals;
+    MidiLog midiLog;
+    void applyMidiEvents();
+    void toggleMidiRecording();
     encoder* encoders[ofxMidiFighterTwister::NUM_ENCODERS];
-    ease* easings[ofxMidiFighterTwister::NUM_ENCODERS];
+    TweenPool::Id encoderTweens[ofxMidiFighterTwister::NUM_ENCODERS];
     void setupMidiFighterTwister();
     void tweenEncoderToCurrentValue(int encoder);
     void onEncoderUpdate(ofxMidiFighterTwister::EncoderEventArgs &);
@@ -0,0 +1,155 @@
+// Reads Tracer's shared-memory video output and reports throughput and
+// latency once a second. Each frame is read in place, the way a compositor
+// would use it, and counted only if the writer did not overwrite it meanwhile.
+//
+//     make shm-reader
+//     bin/tracer-shm-reader [name] [seconds]
+
+#include "SharedFrame.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+uint64_t nowNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct Segment {
+    SharedFrame::Header* header = nullptr;
+    size_t size = 0;
+
+    bool open(std::string const& name) {
+        int const fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        void* memory = MAP_FAILED;
+        if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(SharedFrame::Header)) {
+            memory = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        close(fd);
+        if (memory == MAP_FAILED) {
+            return false;
+        }
+        header = (SharedFrame::Header*)memory;
+        size = info.st_size;
+        if (header->magic != SharedFrame::MAGIC || header->version != SharedFrame::VERSION) {
+            release();
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    void release() {
+        if (header != nullptr) {
+            munmap(header, size);
+            header = nullptr;
+        }
+    }
+};
+
+double percentile(std::vector<double>& values, double fraction) {
+    if (values.empty()) {
+        return 0;
+    }
+    size_t const index = std::min(values.size() - 1, (size_t)(fraction * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    std::string const name = "/" + std::string(argc > 1 ? argv[1] : "tracer");
+    double const seconds = argc > 2 ? atof(argv[2]) : 10;
+
+    Segment segment;
+    uint64_t const deadline = nowNanos() + seconds * 1e9;
+    uint64_t lastFrame = 0;
+    uint64_t reportStart = nowNanos();
+    uint64_t frames = 0, bytes = 0, missed = 0, torn = 0;
+    uint64_t totalFrames = 0, totalMissed = 0, totalTorn = 0;
+    std::vector<double> latencies;
+    uint32_t checksum = 0;
+
+    while (nowNanos() < deadline) {
+        if (segment.header == nullptr || segment.header->closed.load(std::memory_order_acquire)) {
+            segment.release();
+            if (!segment.open(name)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                continue;
+            }
+            auto const& header = *segment.header;
+            printf("%s: %ux%u, %d slots of %llu bytes\n", name.c_str(), header.width, header.height, SharedFrame::SLOT_COUNT, (unsigned long long)header.slotBytes);
+            lastFrame = 0;
+        }
+
+        auto const& header = *segment.header;
+        int const latest = header.latest.load(std::memory_order_acquire);
+        if (latest < 0) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+        auto const& slot = header.slots[latest];
+        uint64_t const before = slot.sequence.load(std::memory_order_acquire);
+        uint64_t const frame = slot.frame;
+        if ((before & 1) || frame == lastFrame) {
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+            continue;
+        }
+
+        uint64_t const rendered = slot.renderedNanos;
+        auto const pixels = (unsigned char const*)&header + header.slotOffset + latest * header.slotBytes;
+        size_t const frameBytes = (size_t)header.stride * header.height;
+        for (size_t i = 0; i < frameBytes; i += 64) {
+            checksum += pixels[i];
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != before) {
+            torn++;
+            continue;
+        }
+
+        if (lastFrame != 0 && frame > lastFrame + 1) {
+            missed += frame - lastFrame - 1;
+        }
+        lastFrame = frame;
+        frames++;
+        bytes += frameBytes;
+        latencies.push_back((nowNanos() - rendered) / 1e6);
+
+        uint64_t const now = nowNanos();
+        if (now - reportStart >= 1e9) {
+            double const elapsed = (now - reportStart) / 1e9;
+            printf("%6.1f frames/s %8.1f MB/s  latency ms p50 %.2f p99 %.2f max %.2f  missed %llu torn %llu\n",
+                frames / elapsed, bytes / elapsed / 1e6, percentile(latencies, 0.5), percentile(latencies, 0.99), percentile(latencies, 1),
+                (unsigned long long)missed, (unsigned long long)torn);
+            totalFrames += frames;
+            totalMissed += missed;
+            totalTorn += torn;
+            frames = bytes = missed = torn = 0;
+            latencies.clear();
+            reportStart = now;
+        }
+    }
+
+    totalFrames += frames;
+    totalMissed += missed;
+    totalTorn += torn;
+    printf("%llu frames read, %llu missed, %llu torn (checksum %u)\n", (unsigned long long)totalFrames, (unsigned long long)totalMissed, (unsigned long long)totalTorn, checksum);
+    segment.release();
+    return totalFrames > 0 ? 0 : 1;
+}